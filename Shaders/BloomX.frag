@@ -3,7 +3,10 @@ uniform float sigma;
 uniform float glowMultiplier;
 uniform float width;
 
-const int KERNEL_SIZE = 50;
+// Taps either side, Shaders defines it from the bloom quality
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 50
+#endif
 float glow = glowMultiplier / (sigma * sqrt(2.0 * 3.14159));
 
 float blurWeight(float x)
@@ -0,0 +1,4 @@
+vec4 combine(vec4 source, vec4 bloom, vec2 uv, float strength)
+{
+    return source + bloom * strength;
+}
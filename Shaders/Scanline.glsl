@@ -0,0 +1,7 @@
+vec4 scanline(vec4 color, vec2 uv, float intensity, float vignette)
+{
+    float line = mod(floor(uv.y * resolution.y), 2.0);
+    vec2 edge = uv - vec2(0.5);
+    float shade = (1.0 - intensity * line) * (1.0 - vignette * dot(edge, edge) * 4.0);
+    return vec4(color.rgb * shade, color.a);
+}
@@ -0,0 +1,4 @@
+vec4 tonemap(vec4 color, vec2 uv, float exposure)
+{
+    return vec4(vec3(1.0) - exp(-color.rgb * exposure), color.a);
+}
@@ -0,0 +1,304 @@
+#include "AllocTracker.h"
+#ifdef RSS_TRACK_ALLOCS
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RSS_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define RSS_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+thread_local int AllocTracker::t_zone = AllocTracker::NO_ZONE;
+thread_local int AllocTracker::t_exempt = 0;
+std::atomic<std::int64_t> AllocTracker::_frameAllocations(0);
+std::atomic<std::int64_t> AllocTracker::_frameBytes(0);
+std::atomic<std::int64_t> AllocTracker::_frameFrees(0);
+std::atomic<std::int64_t> AllocTracker::_frameExempt(0);
+std::atomic<std::int64_t> AllocTracker::_zoneAllocations[AllocTracker::MAX_ZONES + 1];
+std::atomic<std::int64_t> AllocTracker::_zoneBytes[AllocTracker::MAX_ZONES + 1];
+std::atomic<bool> AllocTracker::_callSites(false);
+AllocTracker::Site AllocTracker::_sites[AllocTracker::SITE_CAPACITY];
+
+namespace
+{
+	// Everything below is only touched on the main thread in endFrame/report
+	AllocTracker::Stats lastFrame = { 0, 0 };
+	std::int64_t lastFrees = 0;
+	AllocTracker::Stats lastZones[AllocTracker::MAX_ZONES + 1];
+	AllocTracker::Stats totalZones[AllocTracker::MAX_ZONES + 1];
+	AllocTracker::Stats total = { 0, 0 };
+	std::int64_t frameIndex = 0;
+	std::int64_t budget = 0;
+	int warmup = -1;
+	std::int64_t overBudgetFrames = 0;
+	std::int64_t exemptAllocations = 0;
+	std::int64_t worstFrame = 0;
+	std::int64_t worstFrameIndex = -1;
+}
+
+void AllocTracker::onAllocate(std::size_t size, const void* site)
+{
+	std::int64_t bytes = static_cast<std::int64_t>(size);
+	_frameAllocations.fetch_add(1, std::memory_order_relaxed);
+	_frameBytes.fetch_add(bytes, std::memory_order_relaxed);
+	_zoneAllocations[t_zone].fetch_add(1, std::memory_order_relaxed);
+	_zoneBytes[t_zone].fetch_add(bytes, std::memory_order_relaxed);
+	if (t_exempt > 0)
+	{
+		_frameExempt.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (_callSites.load(std::memory_order_relaxed))
+	{
+		recordSite(site, size);
+	}
+}
+
+void AllocTracker::onFree()
+{
+	_frameFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+int AllocTracker::swapZone(int zone)
+{
+	int previous = t_zone;
+	t_zone = zone < MAX_ZONES ? zone : NO_ZONE;
+	return previous;
+}
+
+void AllocTracker::recordSite(const void* site, std::size_t size)
+{
+	// Open addressing on the return address, must not allocate itself
+	std::uintptr_t address = reinterpret_cast<std::uintptr_t>(site);
+	std::uint64_t slot = (static_cast<std::uint64_t>(address) * 0x9E3779B97F4A7C15ull) >> 52;
+	for (int probe = 0; probe < 64; probe++)
+	{
+		Site& entry = _sites[(slot + probe) & (SITE_CAPACITY - 1)];
+		std::uintptr_t current = entry.address.load(std::memory_order_relaxed);
+		if (current == 0 && entry.address.compare_exchange_strong(current, address, std::memory_order_relaxed))
+		{
+			current = address;
+		}
+		if (current == address)
+		{
+			entry.allocations.fetch_add(1, std::memory_order_relaxed);
+			entry.bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+void AllocTracker::endFrame()
+{
+	lastFrame.allocations = _frameAllocations.exchange(0, std::memory_order_relaxed);
+	lastFrame.bytes = _frameBytes.exchange(0, std::memory_order_relaxed);
+	lastFrees = _frameFrees.exchange(0, std::memory_order_relaxed);
+	for (int zone = 0; zone <= MAX_ZONES; zone++)
+	{
+		lastZones[zone].allocations = _zoneAllocations[zone].exchange(0, std::memory_order_relaxed);
+		lastZones[zone].bytes = _zoneBytes[zone].exchange(0, std::memory_order_relaxed);
+		totalZones[zone].allocations += lastZones[zone].allocations;
+		totalZones[zone].bytes += lastZones[zone].bytes;
+	}
+	total.allocations += lastFrame.allocations;
+	total.bytes += lastFrame.bytes;
+
+	std::int64_t exempt = _frameExempt.exchange(0, std::memory_order_relaxed);
+	std::int64_t counted = lastFrame.allocations - exempt;
+	if (warmup >= 0 && frameIndex >= warmup)
+	{
+		exemptAllocations += exempt;
+		if (counted > budget)
+		{
+			overBudgetFrames++;
+			if (counted > worstFrame)
+			{
+				worstFrame = counted;
+				worstFrameIndex = frameIndex;
+			}
+		}
+	}
+	frameIndex++;
+}
+
+AllocTracker::Stats AllocTracker::getFrameStats()
+{
+	return lastFrame;
+}
+
+AllocTracker::Stats AllocTracker::getZoneStats(int zone)
+{
+	return lastZones[zone < MAX_ZONES ? zone : NO_ZONE];
+}
+
+std::int64_t AllocTracker::getFrameFrees()
+{
+	return lastFrees;
+}
+
+void AllocTracker::setFrameBudget(std::int64_t allocations, int warmupFrames)
+{
+	budget = allocations;
+	warmup = warmupFrames;
+}
+
+bool AllocTracker::isWithinBudget()
+{
+	return overBudgetFrames == 0;
+}
+
+void AllocTracker::setCallSites(bool enabled)
+{
+	_callSites.store(enabled);
+}
+
+void AllocTracker::report(std::ostream& out)
+{
+	// Stop attributing while the report itself allocates
+	bool sites = _callSites.exchange(false);
+
+	out << "ALLOCTRACKER: " << total.allocations << " allocations, " << total.bytes << " bytes over " << frameIndex << " frames" << "\n";
+	if (frameIndex > 0)
+	{
+		out << "ALLOCTRACKER: " << std::fixed << std::setprecision(2) << static_cast<double>(total.allocations) / frameIndex
+			<< std::defaultfloat << " allocations per frame on average" << "\n";
+	}
+	if (warmup >= 0)
+	{
+		if (overBudgetFrames == 0)
+		{
+			out << "ALLOCTRACKER: steady-state budget of " << budget << " allocations per frame held" << "\n";
+		}
+		else
+		{
+			out << "ALLOCTRACKER: " << overBudgetFrames << " frames over the budget of " << budget
+				<< " allocations, worst " << worstFrame << " at frame " << worstFrameIndex << "\n";
+		}
+		if (exemptAllocations > 0)
+		{
+			out << "ALLOCTRACKER: " << exemptAllocations << " allocations that created objects were left out of the budget" << "\n";
+		}
+	}
+
+	std::vector<int> zones;
+	for (int zone = 0; zone <= MAX_ZONES; zone++)
+	{
+		if (totalZones[zone].allocations > 0)
+		{
+			zones.push_back(zone);
+		}
+	}
+	std::sort(zones.begin(), zones.end(), [](int a, int b) { return totalZones[a].allocations > totalZones[b].allocations; });
+	for (int zone : zones)
+	{
+		const char* name = "(no zone)";
+#ifdef RSS_PROFILING
+		if (zone < Profiler::getZoneCount())
+		{
+			name = Profiler::getZoneName(zone);
+		}
+#endif
+		out << "ALLOCTRACKER:   " << name << " " << totalZones[zone].allocations << " allocations, " << totalZones[zone].bytes << " bytes" << "\n";
+	}
+
+	if (sites)
+	{
+		std::vector<int> used;
+		for (int i = 0; i < SITE_CAPACITY; i++)
+		{
+			if (_sites[i].address.load() != 0)
+			{
+				used.push_back(i);
+			}
+		}
+		std::sort(used.begin(), used.end(), [](int a, int b) { return _sites[a].allocations.load() > _sites[b].allocations.load(); });
+		if (used.size() > 20)
+		{
+			used.resize(20);
+		}
+		// Raw return addresses, resolve them against the linker map or in the debugger
+		for (int i : used)
+		{
+			out << "ALLOCTRACKER:   site 0x" << std::hex << _sites[i].address.load() << std::dec
+				<< " " << _sites[i].allocations.load() << " allocations, " << _sites[i].bytes.load() << " bytes" << "\n";
+		}
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	AllocTracker::onAllocate(size, RSS_RETURN_ADDRESS());
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	AllocTracker::onAllocate(size, RSS_RETURN_ADDRESS());
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	AllocTracker::onAllocate(size, RSS_RETURN_ADDRESS());
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	AllocTracker::onAllocate(size, RSS_RETURN_ADDRESS());
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (memory)
+	{
+		AllocTracker::onFree();
+		std::free(memory);
+	}
+}
+
+void operator delete[](void* memory) noexcept
+{
+	if (memory)
+	{
+		AllocTracker::onFree();
+		std::free(memory);
+	}
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	operator delete[](memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete[](memory);
+}
+
+#endif
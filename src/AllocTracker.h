@@ -0,0 +1,85 @@
+#pragma once
+// Heap allocation tracking through replaced global operator new/delete.
+// Opt-in: build with RSS_TRACK_ALLOCS defined, without it ALLOC_FRAME,
+// ALLOC_EXEMPT and ALLOC_REPORT compile to nothing. With RSS_PROFILING also
+// defined the allocations are attributed to the innermost profiler zone.
+#ifdef RSS_TRACK_ALLOCS
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#define ALLOC_FRAME() AllocTracker::endFrame()
+#define ALLOC_REPORT() AllocTracker::report(std::cout)
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+#define ALLOC_EXEMPT() AllocTracker::Exemption ALLOC_CONCAT(_allocExemption, __LINE__)
+
+class AllocTracker
+{
+public:
+	static const int MAX_ZONES = 128;
+	// Slot for allocations made outside of any zone
+	static const int NO_ZONE = MAX_ZONES;
+
+	struct Stats
+	{
+		std::int64_t allocations;
+		std::int64_t bytes;
+	};
+
+	// Allocations on this thread while one is alive create objects on purpose
+	// (a spawn, a notice). They still show in the stats but not against the budget
+	class Exemption
+	{
+	public:
+		Exemption() { t_exempt++; }
+		~Exemption() { t_exempt--; }
+		Exemption(const Exemption&) = delete;
+		Exemption& operator=(const Exemption&) = delete;
+	};
+
+	static void onAllocate(std::size_t size, const void* site);
+	static void onFree();
+	static int swapZone(int zone);
+	static void endFrame();
+
+	static Stats getFrameStats();
+	static Stats getZoneStats(int zone);
+	static std::int64_t getFrameFrees();
+
+	// Steady-state budget: frames after the warm-up whose allocations outside
+	// exemptions exceed the budget are counted and reported at exit
+	static void setFrameBudget(std::int64_t allocations, int warmupFrames);
+	static bool isWithinBudget();
+	static void setCallSites(bool enabled);
+	static void report(std::ostream& out);
+
+private:
+	static const int SITE_CAPACITY = 4096;
+	struct Site
+	{
+		std::atomic<std::uintptr_t> address;
+		std::atomic<std::int64_t> allocations;
+		std::atomic<std::int64_t> bytes;
+	};
+	static void recordSite(const void* site, std::size_t size);
+	static thread_local int t_zone;
+	static thread_local int t_exempt;
+	static std::atomic<std::int64_t> _frameAllocations;
+	static std::atomic<std::int64_t> _frameBytes;
+	static std::atomic<std::int64_t> _frameFrees;
+	static std::atomic<std::int64_t> _frameExempt;
+	static std::atomic<std::int64_t> _zoneAllocations[MAX_ZONES + 1];
+	static std::atomic<std::int64_t> _zoneBytes[MAX_ZONES + 1];
+	static std::atomic<bool> _callSites;
+	static Site _sites[SITE_CAPACITY];
+};
+
+#else
+
+#define ALLOC_FRAME()
+#define ALLOC_REPORT()
+#define ALLOC_EXEMPT()
+
+#endif
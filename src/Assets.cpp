@@ -0,0 +1,77 @@
+#include "Assets.h"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+	struct EmbeddedAsset
+	{
+		const char* name;
+		const unsigned char* data;
+		std::size_t size;
+	};
+
+#include "EmbeddedAssets.inc"
+
+	// Overrides stay loaded, sf::Font keeps reading from the buffer it was given
+	std::mutex overrideMutex;
+	std::map<std::string, std::string> overrides;
+}
+
+std::string Assets::_overrideDirectory;
+
+void Assets::setOverrideDirectory(const std::string& directory)
+{
+	_overrideDirectory = directory;
+}
+
+bool Assets::get(const std::string& name, const void*& data, std::size_t& size)
+{
+	{
+		std::lock_guard<std::mutex> lock(overrideMutex);
+		auto cached = overrides.find(name);
+		if (cached == overrides.end() && !_overrideDirectory.empty())
+		{
+			std::ifstream file(_overrideDirectory + "/" + name, std::ios::binary);
+			if (file)
+			{
+				std::stringstream buffer;
+				buffer << file.rdbuf();
+				cached = overrides.emplace(name, buffer.str()).first;
+				std::cout << "ASSETS: " << name << " overridden from " << _overrideDirectory << "\n";
+			}
+		}
+		if (cached != overrides.end())
+		{
+			data = cached->second.data();
+			size = cached->second.size();
+			return true;
+		}
+	}
+	for (const EmbeddedAsset& asset : EMBEDDED_ASSETS)
+	{
+		if (name == asset.name)
+		{
+			data = asset.data;
+			size = asset.size;
+			return true;
+		}
+	}
+	std::cout << "ASSETS: " << name << " not found" << "\n";
+	return false;
+}
+
+bool Assets::getText(const std::string& name, std::string& text)
+{
+	const void* data = nullptr;
+	std::size_t size = 0;
+	if (!get(name, data, size))
+	{
+		return false;
+	}
+	text.assign(static_cast<const char*>(data), size);
+	return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Font and shader files compiled into the binary (see tools/embed_assets.py).
+// When an override directory is set (--assets <dir>), a file with the same
+// relative path there wins, so shaders can be edited without a rebuild.
+class Assets
+{
+public:
+	static bool get(const std::string& name, const void*& data, std::size_t& size);
+	static bool getText(const std::string& name, std::string& text);
+	static void setOverrideDirectory(const std::string& directory);
+private:
+	static std::string _overrideDirectory;
+};
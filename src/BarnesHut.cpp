@@ -0,0 +1,410 @@
+#include "BarnesHut.h"
+#include "Random.h"
+#include <SFML/System/Clock.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// 16 bits per axis in a 32-bit Morton code, so at most 16 splits
+	const int MAX_LEVEL = 16;
+	const int LEAF_SIZE = 8;
+	// Levels laid out serially before the rest is handed out, 2 gives up to 16 subtrees
+	const int PARALLEL_LEVEL = 2;
+	const int GRAIN = 256;
+	// Each visit pops one node and pushes at most four
+	const int STACK_SIZE = 3 * (MAX_LEVEL + 1) + 4;
+	const std::uint64_t INDEX_MASK = 0xFFFFFFFFull;
+
+	std::uint32_t spreadBits(std::uint32_t v)
+	{
+		v &= 0x0000FFFF;
+		v = (v | (v << 8)) & 0x00FF00FF;
+		v = (v | (v << 4)) & 0x0F0F0F0F;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+
+	std::uint32_t quantize(float value, float scale)
+	{
+		return static_cast<std::uint32_t>(std::clamp(value * scale, 0.0f, 65535.0f));
+	}
+}
+
+bool BarnesHut::Node::isLeaf() const
+{
+	return children[0] < 0 && children[1] < 0 && children[2] < 0 && children[3] < 0;
+}
+
+BarnesHut::BarnesHut() :
+	_theta(0.5f),
+	_softening(0.5f),
+	_strength(1.0f)
+{
+}
+
+void BarnesHut::setParameters(float theta, float softening, float strength)
+{
+	_theta = theta;
+	_softening = softening;
+	_strength = strength;
+}
+
+int BarnesHut::getNodeCount() const
+{
+	return static_cast<int>(_nodes.size());
+}
+
+void BarnesHut::build(const std::vector<sf::Vector2f>& positions, const std::vector<float>& masses, ThreadPool& pool)
+{
+	int count = static_cast<int>(positions.size());
+	_nodes.clear();
+	_pending.clear();
+	_keys.resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	float minX = positions[0].x;
+	float minY = positions[0].y;
+	float maxX = minX;
+	float maxY = minY;
+	for (const sf::Vector2f& p : positions)
+	{
+		minX = std::min(minX, p.x);
+		minY = std::min(minY, p.y);
+		maxX = std::max(maxX, p.x);
+		maxY = std::max(maxY, p.y);
+	}
+	float size = std::max(std::max(maxX - minX, maxY - minY), 1e-3f);
+	float scale = 65535.0f / size;
+
+	// Morton code in the high half, input index in the low half, so equal codes still sort the same way every run
+	auto encode = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			std::uint32_t code = spreadBits(quantize(positions[i].x - minX, scale)) | (spreadBits(quantize(positions[i].y - minY, scale)) << 1);
+			_keys[i] = (static_cast<std::uint64_t>(code) << 32) | static_cast<std::uint32_t>(i);
+		}
+	};
+	pool.parallelFor(count, GRAIN * 4, encode);
+	std::sort(_keys.begin(), _keys.end());
+
+	_x.resize(count);
+	_y.resize(count);
+	_mass.resize(count);
+	auto gather = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			int body = static_cast<int>(_keys[i] & INDEX_MASK);
+			_x[i] = positions[body].x;
+			_y[i] = positions[body].y;
+			_mass[i] = masses[body];
+		}
+	};
+	pool.parallelFor(count, GRAIN * 4, gather);
+
+	buildTop(0, count, 0, size);
+	int topCount = static_cast<int>(_nodes.size());
+	int subtreeCount = static_cast<int>(_pending.size());
+	if (static_cast<int>(_subtrees.size()) < subtreeCount)
+	{
+		_subtrees.resize(subtreeCount);
+	}
+	auto buildSubtrees = [&](int begin, int end) {
+		for (int k = begin; k < end; k++)
+		{
+			const Subtree& subtree = _pending[k];
+			_subtrees[k].clear();
+			buildNode(_subtrees[k], subtree.first, subtree.count, subtree.level, subtree.size);
+		}
+	};
+	pool.parallelFor(subtreeCount, 1, buildSubtrees);
+
+	// Append each subtree behind the top levels and hook its root to its parent
+	for (int k = 0; k < subtreeCount; k++)
+	{
+		int offset = static_cast<int>(_nodes.size());
+		for (Node node : _subtrees[k])
+		{
+			for (int& child : node.children)
+			{
+				if (child >= 0)
+				{
+					child += offset;
+				}
+			}
+			_nodes.push_back(node);
+		}
+		_nodes[_pending[k].parent].children[_pending[k].quadrant] = offset;
+	}
+	// Top nodes are stored parent first, so walking back finishes children before parents
+	for (int i = topCount - 1; i >= 0; i--)
+	{
+		finishNode(_nodes, i);
+	}
+}
+
+int BarnesHut::quadrantEnd(int first, int end, int level, int quadrant) const
+{
+	// Bodies in one cell share every code bit above this level, so the quadrants come in order
+	int shift = 2 * (MAX_LEVEL - 1 - level);
+	auto it = std::partition_point(_keys.begin() + first, _keys.begin() + end, [shift, quadrant](std::uint64_t key) {
+		return static_cast<int>(((key >> 32) >> shift) & 3) <= quadrant;
+	});
+	return static_cast<int>(it - _keys.begin());
+}
+
+int BarnesHut::buildTop(int first, int count, int level, float size)
+{
+	int index = static_cast<int>(_nodes.size());
+	_nodes.push_back(Node{ 0.0f, 0.0f, 0.0f, size, { -1, -1, -1, -1 }, first, count });
+	if (count <= LEAF_SIZE || level >= MAX_LEVEL)
+	{
+		return index;
+	}
+	int start = first;
+	int end = first + count;
+	for (int q = 0; q < 4; q++)
+	{
+		int stop = quadrantEnd(start, end, level, q);
+		if (stop > start)
+		{
+			if (level + 1 < PARALLEL_LEVEL)
+			{
+				int child = buildTop(start, stop - start, level + 1, size * 0.5f);
+				_nodes[index].children[q] = child;
+			}
+			else
+			{
+				_pending.push_back(Subtree{ index, q, start, stop - start, level + 1, size * 0.5f });
+			}
+		}
+		start = stop;
+	}
+	return index;
+}
+
+int BarnesHut::buildNode(std::vector<Node>& nodes, int first, int count, int level, float size) const
+{
+	int index = static_cast<int>(nodes.size());
+	nodes.push_back(Node{ 0.0f, 0.0f, 0.0f, size, { -1, -1, -1, -1 }, first, count });
+	if (count > LEAF_SIZE && level < MAX_LEVEL)
+	{
+		int start = first;
+		int end = first + count;
+		for (int q = 0; q < 4; q++)
+		{
+			int stop = quadrantEnd(start, end, level, q);
+			if (stop > start)
+			{
+				int child = buildNode(nodes, start, stop - start, level + 1, size * 0.5f);
+				nodes[index].children[q] = child;
+			}
+			start = stop;
+		}
+	}
+	finishNode(nodes, index);
+	return index;
+}
+
+void BarnesHut::finishNode(std::vector<Node>& nodes, int index) const
+{
+	Node& node = nodes[index];
+	float mass = 0.0f;
+	float momentX = 0.0f;
+	float momentY = 0.0f;
+	if (node.isLeaf())
+	{
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			mass += _mass[i];
+			momentX += _x[i] * _mass[i];
+			momentY += _y[i] * _mass[i];
+		}
+	}
+	else
+	{
+		for (int child : node.children)
+		{
+			if (child >= 0)
+			{
+				const Node& c = nodes[child];
+				mass += c.mass;
+				momentX += c.massX * c.mass;
+				momentY += c.massY * c.mass;
+			}
+		}
+	}
+	node.mass = mass;
+	node.massX = mass > 0.0f ? momentX / mass : 0.0f;
+	node.massY = mass > 0.0f ? momentY / mass : 0.0f;
+}
+
+sf::Vector2f BarnesHut::accelerationAt(int body) const
+{
+	float x = _x[body];
+	float y = _y[body];
+	float ax = 0.0f;
+	float ay = 0.0f;
+	float soft2 = _softening * _softening;
+	float theta2 = _theta * _theta;
+	int stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = _nodes[stack[--top]];
+		if (node.isLeaf())
+		{
+			for (int j = node.first; j < node.first + node.count; j++)
+			{
+				if (j == body)
+				{
+					continue;
+				}
+				float dx = _x[j] - x;
+				float dy = _y[j] - y;
+				float d2 = dx * dx + dy * dy + soft2;
+				float inv = 1.0f / (d2 * std::sqrt(d2));
+				ax += _mass[j] * dx * inv;
+				ay += _mass[j] * dy * inv;
+			}
+			continue;
+		}
+		float dx = node.massX - x;
+		float dy = node.massY - y;
+		float d2 = dx * dx + dy * dy;
+		if (node.size * node.size < theta2 * d2)
+		{
+			d2 += soft2;
+			float inv = 1.0f / (d2 * std::sqrt(d2));
+			ax += node.mass * dx * inv;
+			ay += node.mass * dy * inv;
+			continue;
+		}
+		for (int child : node.children)
+		{
+			if (child >= 0)
+			{
+				stack[top++] = child;
+			}
+		}
+	}
+	return sf::Vector2f(ax * _strength, ay * _strength);
+}
+
+void BarnesHut::computeAccelerations(std::vector<sf::Vector2f>& accelerations, ThreadPool& pool) const
+{
+	int count = static_cast<int>(_keys.size());
+	accelerations.resize(count);
+	if (_nodes.empty())
+	{
+		return;
+	}
+	// Walk in Morton order so neighbouring bodies on a thread share most of the tree they visit
+	auto forces = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			accelerations[_keys[i] & INDEX_MASK] = accelerationAt(i);
+		}
+	};
+	pool.parallelFor(count, GRAIN, forces);
+}
+
+void BarnesHut::computeDirect(const std::vector<sf::Vector2f>& positions, const std::vector<float>& masses, std::vector<sf::Vector2f>& accelerations, ThreadPool& pool) const
+{
+	int count = static_cast<int>(positions.size());
+	accelerations.resize(count);
+	float soft2 = _softening * _softening;
+	auto forces = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			float ax = 0.0f;
+			float ay = 0.0f;
+			for (int j = 0; j < count; j++)
+			{
+				if (j == i)
+				{
+					continue;
+				}
+				float dx = positions[j].x - positions[i].x;
+				float dy = positions[j].y - positions[i].y;
+				float d2 = dx * dx + dy * dy + soft2;
+				float inv = 1.0f / (d2 * std::sqrt(d2));
+				ax += masses[j] * dx * inv;
+				ay += masses[j] * dy * inv;
+			}
+			accelerations[i] = sf::Vector2f(ax * _strength, ay * _strength);
+		}
+	};
+	pool.parallelFor(count, 16, forces);
+}
+
+int BarnesHut::benchmark(int bodies, int threads)
+{
+	// A 1080p screen at the default 10 pixels per meter, masses as MyCircle gives them
+	const float WIDTH = 192.0f;
+	const float HEIGHT = 108.0f;
+	const float THETAS[] = { 0.3f, 0.5f, 0.7f, 1.0f };
+	const int REPEATS = 5;
+
+	ThreadPool pool(threads);
+	std::vector<sf::Vector2f> positions(bodies);
+	std::vector<float> masses(bodies);
+	for (int i = 0; i < bodies; i++)
+	{
+		positions[i] = sf::Vector2f(Random::uniform(0.0f, WIDTH), Random::uniform(0.0f, HEIGHT));
+		masses[i] = Random::uniform(0.2f, 1.0f) * 2.0f;
+	}
+	std::cout << "NBODY: " << bodies << " bodies, " << pool.getThreadCount() << " threads, seed " << Random::getSeed() << "\n";
+
+	BarnesHut tree;
+	std::vector<sf::Vector2f> direct;
+	sf::Clock clock;
+	tree.computeDirect(positions, masses, direct, pool);
+	float directMs = clock.getElapsedTime().asSeconds() * 1000.0f;
+	std::cout << "NBODY: direct summation " << directMs << " ms" << "\n";
+
+	std::vector<sf::Vector2f> approx;
+	for (float theta : THETAS)
+	{
+		tree.setParameters(theta, 0.5f, 1.0f);
+		float buildMs = 0.0f;
+		float forceMs = 0.0f;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			clock.restart();
+			tree.build(positions, masses, pool);
+			float built = clock.getElapsedTime().asSeconds() * 1000.0f;
+			tree.computeAccelerations(approx, pool);
+			float total = clock.getElapsedTime().asSeconds() * 1000.0f;
+			if (r == 0 || total < buildMs + forceMs)
+			{
+				buildMs = built;
+				forceMs = total - built;
+			}
+		}
+		// Relative to the typical acceleration, bodies where the pull nearly cancels would dominate a per-body ratio
+		double squared = 0.0;
+		double reference = 0.0;
+		double worst = 0.0;
+		for (int i = 0; i < bodies; i++)
+		{
+			sf::Vector2f diff = approx[i] - direct[i];
+			double error = diff.x * diff.x + diff.y * diff.y;
+			squared += error;
+			reference += direct[i].x * direct[i].x + direct[i].y * direct[i].y;
+			worst = std::max(worst, error);
+		}
+		double scale = std::sqrt(std::max(reference, 1e-18) / std::max(bodies, 1));
+		double rms = std::sqrt(squared / std::max(bodies, 1)) / scale;
+		worst = std::sqrt(worst) / scale;
+		std::cout << "NBODY: theta " << theta << "  build " << buildMs << " ms  forces " << forceMs << " ms  nodes " << tree.getNodeCount()
+			<< "  speedup " << directMs / std::max(buildMs + forceMs, 1e-3f) << "x  rms error " << rms * 100.0 << "%  max error " << worst * 100.0 << "%" << "\n";
+	}
+	return 0;
+}
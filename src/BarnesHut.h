@@ -0,0 +1,61 @@
+#pragma once
+#include "ThreadPool.h"
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <vector>
+
+// Mutual gravity through a Barnes-Hut quadtree. Bodies are sorted along a
+// Morton curve so every cell is a contiguous run of them. The top two levels
+// are laid out first, the subtrees below them build in parallel, and the force
+// pass walks the tree once per body, also in parallel. A cell narrower than
+// theta times its distance acts as one body at its centre of mass.
+class BarnesHut
+{
+public:
+	BarnesHut();
+	void setParameters(float theta, float softening, float strength);
+	void build(const std::vector<sf::Vector2f>& positions, const std::vector<float>& masses, ThreadPool& pool);
+	// Acceleration of every body from all the others, indexed like the build input
+	void computeAccelerations(std::vector<sf::Vector2f>& accelerations, ThreadPool& pool) const;
+	// O(n^2) reference over the same input
+	void computeDirect(const std::vector<sf::Vector2f>& positions, const std::vector<float>& masses, std::vector<sf::Vector2f>& accelerations, ThreadPool& pool) const;
+	int getNodeCount() const;
+	// Times tree and direct summation on random bodies and prints the tree's error
+	static int benchmark(int bodies, int threads);
+private:
+	struct Node
+	{
+		float massX;
+		float massY;
+		float mass;
+		float size;
+		int children[4];
+		int first;
+		int count;
+		bool isLeaf() const;
+	};
+	struct Subtree
+	{
+		int parent;
+		int quadrant;
+		int first;
+		int count;
+		int level;
+		float size;
+	};
+	float _theta;
+	float _softening;
+	float _strength;
+	std::vector<std::uint64_t> _keys;
+	std::vector<float> _x;
+	std::vector<float> _y;
+	std::vector<float> _mass;
+	std::vector<Node> _nodes;
+	std::vector<Subtree> _pending;
+	std::vector<std::vector<Node>> _subtrees;
+	int quadrantEnd(int first, int end, int level, int quadrant) const;
+	int buildTop(int first, int count, int level, float size);
+	int buildNode(std::vector<Node>& nodes, int first, int count, int level, float size) const;
+	void finishNode(std::vector<Node>& nodes, int index) const;
+	sf::Vector2f accelerationAt(int body) const;
+};
@@ -0,0 +1,120 @@
+#include "CircleBatch.h"
+#include "Counters.h"
+#include "HSV.h"
+#include <cmath>
+
+CircleBatch::CircleBatch()
+{
+}
+
+void CircleBatch::clear()
+{
+	// Keeps capacity, steady-state frames don't reallocate
+	_positions.clear();
+	_radii.clear();
+	_pointCounts.clear();
+	_hues.clear();
+	_saturations.clear();
+	_values.clear();
+	_vertices.clear();
+}
+
+void CircleBatch::add(const MyCircle& circle)
+{
+	_positions.push_back(circle._circle->getPosition());
+	_radii.push_back(circle._circle->getRadius());
+	_pointCounts.push_back(circle.getLodPointCount());
+	_hues.push_back(circle.getHue());
+	_saturations.push_back(circle.getSaturation());
+	_values.push_back(circle.getValue());
+}
+
+void CircleBatch::build()
+{
+	size_t count = _positions.size();
+	_colors.resize(count);
+	HSV::toRGB(_hues.data(), _saturations.data(), _values.data(), _colors.data(), count);
+
+	size_t total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		total += _pointCounts[i] * 3;
+	}
+	_vertices.resize(total);
+
+	sf::Vertex* out = _vertices.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		const std::vector<sf::Vector2f>& unit = unitCircle(_pointCounts[i]);
+		sf::Vector2f center = _positions[i];
+		float r = _radii[i];
+		sf::Color color = _colors[i];
+		size_t points = unit.size();
+		for (size_t k = 0; k < points; k++)
+		{
+			const sf::Vector2f& a = unit[k];
+			const sf::Vector2f& b = unit[k + 1 == points ? 0 : k + 1];
+			out[0].position = center;
+			out[1].position = sf::Vector2f(center.x + a.x * r, center.y + a.y * r);
+			out[2].position = sf::Vector2f(center.x + b.x * r, center.y + b.y * r);
+			out[0].color = color;
+			out[1].color = color;
+			out[2].color = color;
+			out += 3;
+		}
+	}
+}
+
+size_t CircleBatch::getCircleCount() const
+{
+	return _positions.size();
+}
+
+size_t CircleBatch::getVertexCount() const
+{
+	return _vertices.size();
+}
+
+const std::vector<sf::Vector2f>& CircleBatch::getPositions() const
+{
+	return _positions;
+}
+
+const std::vector<float>& CircleBatch::getRadii() const
+{
+	return _radii;
+}
+
+const std::vector<sf::Color>& CircleBatch::getColors() const
+{
+	return _colors;
+}
+
+const std::vector<sf::Vector2f>& CircleBatch::unitCircle(std::size_t points)
+{
+	if (_unitCircles.size() <= points)
+	{
+		_unitCircles.resize(points + 1);
+	}
+	std::vector<sf::Vector2f>& unit = _unitCircles[points];
+	if (unit.empty())
+	{
+		// Same start angle as sf::CircleShape
+		for (std::size_t k = 0; k < points; k++)
+		{
+			float angle = k * 2.0f * 3.14159265f / points - 3.14159265f / 2.0f;
+			unit.emplace_back(std::cos(angle), std::sin(angle));
+		}
+	}
+	return unit;
+}
+
+void CircleBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	if (!_vertices.empty())
+	{
+		target.draw(_vertices.data(), _vertices.size(), sf::Triangles, states);
+		PROFILE_COUNT(Counters::DrawCalls, 1);
+		PROFILE_COUNT(Counters::Vertices, static_cast<std::int64_t>(_vertices.size()));
+	}
+}
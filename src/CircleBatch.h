@@ -0,0 +1,33 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include "MyCircle.h"
+#include <vector>
+
+// Draws all visible circles as one triangle list. Colours for the whole
+// frame are converted in one HSV batch and written directly into the vertices.
+class CircleBatch : public sf::Drawable
+{
+public:
+	CircleBatch();
+	void clear();
+	void add(const MyCircle& circle);
+	void build();
+	size_t getCircleCount() const;
+	size_t getVertexCount() const;
+	// The frame's circles after build, for renderers that don't take the vertices
+	const std::vector<sf::Vector2f>& getPositions() const;
+	const std::vector<float>& getRadii() const;
+	const std::vector<sf::Color>& getColors() const;
+private:
+	std::vector<sf::Vector2f> _positions;
+	std::vector<float> _radii;
+	std::vector<std::size_t> _pointCounts;
+	std::vector<float> _hues;
+	std::vector<float> _saturations;
+	std::vector<float> _values;
+	std::vector<sf::Color> _colors;
+	std::vector<sf::Vertex> _vertices;
+	const std::vector<sf::Vector2f>& unitCircle(std::size_t points);
+	std::vector<std::vector<sf::Vector2f>> _unitCircles;
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
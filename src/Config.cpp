@@ -0,0 +1,346 @@
+#include "Config.h"
+#include <SFML/System/Clock.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::atomic<const Config::Values*> Config::_values(new Config::Values(Config::defaults()));
+std::string Config::_path;
+
+namespace
+{
+	const float POLL_INTERVAL = 1.0f;
+	const char* SOLVERS[] = { "reference", "batched", "parallel" };
+
+	sf::Clock pollClock;
+	std::filesystem::file_time_type lastWrite;
+	bool fileFound = false;
+	// Converted once, a std::string argument would build a new path on every poll
+	std::filesystem::path watchedPath;
+
+	std::string trim(const std::string& text)
+	{
+		size_t first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos)
+		{
+			return "";
+		}
+		size_t last = text.find_last_not_of(" \t\r");
+		return text.substr(first, last - first + 1);
+	}
+
+	bool parseBool(const std::string& value, bool& out)
+	{
+		if (value == "true" || value == "on" || value == "1")
+		{
+			out = true;
+			return true;
+		}
+		if (value == "false" || value == "off" || value == "0")
+		{
+			out = false;
+			return true;
+		}
+		return false;
+	}
+}
+
+Config::Values Config::defaults()
+{
+	Values values;
+	values.frameCap = 144;
+	values.physicsRate = 0.0f;
+	values.subSteps = 2;
+	values.broadPhase = "grid";
+	values.skin = 0.3f;
+	values.solver = "reference";
+	values.threads = 0;
+	values.gravity = "down";
+	values.theta = 0.5f;
+	values.softening = 0.5f;
+	values.attraction = 1.0f;
+	values.bloom = true;
+	values.bloomQuality = "high";
+	values.autoRenderScale = true;
+	values.renderScale = 1.0f;
+	values.frameBudgetMs = 1000.0f / 144.0f;
+	values.lodMaxError = 0.25f;
+	values.introCount = 1000;
+	values.introInterval = 0.01f;
+	values.spawnInterval = 0.05f;
+	values.maxCircles = 0;
+	return values;
+}
+
+bool Config::load(const std::string& path)
+{
+	_path = path;
+	watchedPath = path;
+	Values values = defaults();
+	std::error_code error;
+	fileFound = std::filesystem::exists(path, error);
+	if (!fileFound)
+	{
+		publish(values);
+		std::cout << "CONFIG: " << path << " not found, using defaults" << "\n";
+		return false;
+	}
+	lastWrite = std::filesystem::last_write_time(path, error);
+	parse(path, values);
+	publish(values);
+	std::cout << "CONFIG: " << path << " - SUCCESS" << "\n";
+	return true;
+}
+
+bool Config::poll()
+{
+	if (_path.empty() || pollClock.getElapsedTime().asSeconds() < POLL_INTERVAL)
+	{
+		return false;
+	}
+	pollClock.restart();
+
+	std::error_code error;
+	if (!std::filesystem::exists(watchedPath, error))
+	{
+		fileFound = false;
+		return false;
+	}
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(watchedPath, error);
+	if (error || (fileFound && writeTime == lastWrite))
+	{
+		return false;
+	}
+	fileFound = true;
+	lastWrite = writeTime;
+
+	// A file caught mid-save fails to parse, keep the old values until the next change
+	Values values = defaults();
+	if (!parse(_path, values))
+	{
+		return false;
+	}
+	publish(values);
+	std::cout << "CONFIG: " << _path << " reloaded" << "\n";
+	return true;
+}
+
+const Config::Values& Config::get()
+{
+	return *_values.load(std::memory_order_acquire);
+}
+
+void Config::publish(const Values& values)
+{
+	// Readers may still hold the old snapshot, it is leaked on purpose
+	_values.store(new Values(values), std::memory_order_release);
+}
+
+bool Config::override(const std::string& key, const std::string& value)
+{
+	Values values = get();
+	if (!set(values, key, value))
+	{
+		std::cout << "CONFIG: bad value or unknown key " << key << " = " << value << "\n";
+		return false;
+	}
+	publish(values);
+	return true;
+}
+
+const std::string& Config::getPath()
+{
+	return _path;
+}
+
+bool Config::parse(const std::string& path, Values& values)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+	std::string section;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t comment = line.find_first_of(";#");
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+		line = trim(line);
+		if (line.empty())
+		{
+			continue;
+		}
+		if (line.front() == '[' && line.back() == ']')
+		{
+			section = trim(line.substr(1, line.size() - 2));
+			continue;
+		}
+		size_t eq = line.find('=');
+		if (eq == std::string::npos)
+		{
+			std::cout << "CONFIG: line " << lineNumber << ": expected key = value" << "\n";
+			continue;
+		}
+		std::string key = section + "." + trim(line.substr(0, eq));
+		std::string value = trim(line.substr(eq + 1));
+		if (!set(values, key, value))
+		{
+			std::cout << "CONFIG: line " << lineNumber << ": bad value or unknown key " << key << " = " << value << "\n";
+		}
+	}
+	return true;
+}
+
+bool Config::set(Values& values, const std::string& key, const std::string& value)
+{
+	try
+	{
+		if (key == "display.frameCap")
+		{
+			values.frameCap = std::max(0, std::stoi(value));
+		}
+		else if (key == "display.windows")
+		{
+			return parseWindows(value, values.windows);
+		}
+		else if (key == "physics.rate")
+		{
+			values.physicsRate = std::max(0.0f, std::stof(value));
+		}
+		else if (key == "physics.subSteps")
+		{
+			// The integrator runs subSteps - 1 passes, fewer than 2 would stop all motion
+			values.subSteps = std::max(2, std::stoi(value));
+		}
+		else if (key == "physics.broadPhase")
+		{
+			if (value != "grid" && value != "verlet" && value != "none")
+			{
+				return false;
+			}
+			values.broadPhase = value;
+		}
+		else if (key == "physics.skin")
+		{
+			values.skin = std::max(0.0f, std::stof(value));
+		}
+		else if (key == "physics.solver")
+		{
+			if (std::find(std::begin(SOLVERS), std::end(SOLVERS), value) == std::end(SOLVERS))
+			{
+				return false;
+			}
+			values.solver = value;
+		}
+		else if (key == "physics.threads")
+		{
+			values.threads = std::max(0, std::stoi(value));
+		}
+		else if (key == "physics.gravity")
+		{
+			if (value != "down" && value != "attraction")
+			{
+				return false;
+			}
+			values.gravity = value;
+		}
+		else if (key == "physics.theta")
+		{
+			values.theta = std::clamp(std::stof(value), 0.0f, 1.5f);
+		}
+		else if (key == "physics.softening")
+		{
+			// Keeps two overlapping bodies from pulling each other to infinity
+			values.softening = std::max(0.01f, std::stof(value));
+		}
+		else if (key == "physics.attraction")
+		{
+			values.attraction = std::max(0.0f, std::stof(value));
+		}
+		else if (key == "render.bloom")
+		{
+			return parseBool(value, values.bloom);
+		}
+		else if (key == "render.bloomQuality")
+		{
+			if (value != "low" && value != "medium" && value != "high" && value != "ultra")
+			{
+				return false;
+			}
+			values.bloomQuality = value;
+		}
+		else if (key == "render.renderScale")
+		{
+			values.autoRenderScale = value == "auto";
+			if (!values.autoRenderScale)
+			{
+				values.renderScale = std::clamp(std::stof(value), 0.5f, 1.0f);
+			}
+		}
+		else if (key == "render.frameBudgetMs")
+		{
+			values.frameBudgetMs = std::max(1.0f, std::stof(value));
+		}
+		else if (key == "render.lodMaxError")
+		{
+			values.lodMaxError = std::max(0.01f, std::stof(value));
+		}
+		else if (key == "spawn.introCount")
+		{
+			values.introCount = std::max(1, std::stoi(value));
+		}
+		else if (key == "spawn.introInterval")
+		{
+			values.introInterval = std::max(0.0f, std::stof(value));
+		}
+		else if (key == "spawn.spawnInterval")
+		{
+			values.spawnInterval = std::max(0.0f, std::stof(value));
+		}
+		else if (key == "spawn.maxCircles")
+		{
+			values.maxCircles = std::max(0, std::stoi(value));
+		}
+		else
+		{
+			return false;
+		}
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool Config::parseWindows(const std::string& value, std::vector<WindowRect>& windows)
+{
+	// x,y,width,height per window, windows separated by '|'
+	std::vector<WindowRect> parsed;
+	std::stringstream list(value);
+	std::string entry;
+	while (std::getline(list, entry, '|'))
+	{
+		WindowRect rect;
+		char comma1 = 0;
+		char comma2 = 0;
+		char comma3 = 0;
+		std::stringstream fields(trim(entry));
+		if (!(fields >> rect.x >> comma1 >> rect.y >> comma2 >> rect.width >> comma3 >> rect.height)
+			|| comma1 != ',' || comma2 != ',' || comma3 != ',' || rect.width <= 0 || rect.height <= 0)
+		{
+			return false;
+		}
+		parsed.push_back(rect);
+	}
+	windows = parsed;
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Performance knobs read from an INI file at startup. The primary world polls
+// the file once a second; a reload publishes a new immutable snapshot, so worlds
+// on other threads read get() without locking and spot a change by its address.
+// Snapshots are never freed. Missing keys keep their defaults.
+class Config
+{
+public:
+	struct WindowRect
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+	struct Values
+	{
+		// [display]
+		int frameCap;
+		// One world per entry, empty = a single fullscreen window. Read at startup only
+		std::vector<WindowRect> windows;
+		// [physics]
+		float physicsRate;
+		int subSteps;
+		std::string broadPhase;
+		// verlet: neighbour lists rebuilt once a circle moves more than skin / 2 meters
+		float skin;
+		std::string solver;
+		int threads;
+		// "down" or "attraction", the Barnes-Hut parameters only matter for the latter
+		std::string gravity;
+		float theta;
+		float softening;
+		float attraction;
+		// [render]
+		bool bloom;
+		std::string bloomQuality;
+		bool autoRenderScale;
+		float renderScale;
+		float frameBudgetMs;
+		float lodMaxError;
+		// [spawn]
+		int introCount;
+		float introInterval;
+		float spawnInterval;
+		int maxCircles;
+	};
+	static bool load(const std::string& path);
+	static bool poll();
+	static const Values& get();
+	// Changes one key of the live values, for command line modes. Lost on the next reload
+	static bool override(const std::string& key, const std::string& value);
+	static const std::string& getPath();
+private:
+	static Values defaults();
+	static bool parse(const std::string& path, Values& values);
+	static bool set(Values& values, const std::string& key, const std::string& value);
+	static bool parseWindows(const std::string& value, std::vector<WindowRect>& windows);
+	static void publish(const Values& values);
+	static std::atomic<const Values*> _values;
+	static std::string _path;
+};
@@ -0,0 +1,319 @@
+#include "ContactSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Contacts per task, a colour smaller than this runs on the calling thread
+	const int PARALLEL_GRAIN = 256;
+}
+
+ContactSolver::ContactSolver() :
+	_colourCount(0)
+{
+}
+
+void ContactSolver::reserve(int count)
+{
+	_x.reserve(count);
+	_y.reserve(count);
+	_vx.reserve(count);
+	_vy.reserve(count);
+	_mass.reserve(count);
+	_inverseMass.reserve(count);
+	_radius.reserve(count);
+	_touched.reserve(count);
+	_colourMask.reserve(count);
+	_lastBatch.reserve(count);
+}
+
+void ContactSolver::gather(const std::vector<std::shared_ptr<MyCircle>>& circles)
+{
+	std::size_t count = circles.size();
+	_x.resize(count);
+	_y.resize(count);
+	_vx.resize(count);
+	_vy.resize(count);
+	_mass.resize(count);
+	_inverseMass.resize(count);
+	_radius.resize(count);
+	_touched.assign(count, 0);
+	_contacts.clear();
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const MyCircle& circle = *circles[i];
+		sf::Vector2f position = circle.getPositionInMetersFromPixels();
+		sf::Vector2f velocity = circle.getVelocity();
+		_x[i] = position.x;
+		_y[i] = position.y;
+		_vx[i] = velocity.x;
+		_vy[i] = velocity.y;
+		_mass[i] = circle.getMass();
+		_inverseMass[i] = 1.0f / _mass[i];
+		_radius[i] = circle.getRadiusInMetersFromPixels();
+	}
+}
+
+bool ContactSolver::addPair(int a, int b)
+{
+	float dx = _x[b] - _x[a];
+	float dy = _y[b] - _y[a];
+	float distanceSquared = dx * dx + dy * dy;
+	float radii = _radius[a] + _radius[b];
+	if (distanceSquared >= radii * radii)
+	{
+		return false;
+	}
+	float massRatio = _mass[b] / _mass[a];
+	float restitution = MyCircle::calculateRestitution(massRatio);
+	float distance = std::sqrt(distanceSquared);
+	float inverseDistance = distance > 0.0f ? 1.0f / distance : 0.0f;
+
+	Contact contact;
+	contact.a = a;
+	contact.b = b;
+	// The reference solver's effective mass, kept as is so both backends agree
+	contact.impulseScale = (1.0f + restitution) / (_inverseMass[a] + 1.0f / (_mass[b] * massRatio));
+	contact.normalX = dx * inverseDistance;
+	contact.normalY = dy * inverseDistance;
+	contact.penetration = radii - distance;
+	_contacts.push_back(contact);
+	return true;
+}
+
+void ContactSolver::solve()
+{
+	int count = static_cast<int>(_contacts.size());
+	// Greedy packing: a contact joins the first batch with room after the last one
+	// holding either of its circles, so every circle sees its contacts in order
+	_lastBatch.assign(_x.size(), -1);
+	_batchOf.resize(count);
+	_batchStart.assign(count + 1, 0);
+	_nextOpen.resize(count + 1);
+	for (int batch = 0; batch <= count; batch++)
+	{
+		_nextOpen[batch] = batch;
+	}
+	int batches = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const Contact& c = _contacts[i];
+		int batch = findOpenBatch(std::max(_lastBatch[c.a], _lastBatch[c.b]) + 1);
+		_batchOf[i] = batch;
+		_lastBatch[c.a] = batch;
+		_lastBatch[c.b] = batch;
+		if (++_batchStart[batch + 1] == BATCH)
+		{
+			_nextOpen[batch] = batch + 1;
+		}
+		batches = std::max(batches, batch + 1);
+	}
+	for (int batch = 0; batch < batches; batch++)
+	{
+		_batchStart[batch + 1] += _batchStart[batch];
+	}
+	_ordered.resize(count);
+	_fill.assign(_batchStart.begin(), _batchStart.begin() + batches);
+	for (int i = 0; i < count; i++)
+	{
+		_ordered[_fill[_batchOf[i]]++] = _contacts[i];
+	}
+
+	float impulse[BATCH];
+	for (int batch = 0; batch < batches; batch++)
+	{
+		const Contact* lane = &_ordered[_batchStart[batch]];
+		int lanes = _batchStart[batch + 1] - _batchStart[batch];
+		// Lanes share no circle: all reads first, then every lane commits
+		for (int k = 0; k < lanes; k++)
+		{
+			const Contact& c = lane[k];
+			float relative = (_vx[c.b] - _vx[c.a]) * c.normalX + (_vy[c.b] - _vy[c.a]) * c.normalY;
+			impulse[k] = c.impulseScale * relative;
+		}
+		for (int k = 0; k < lanes; k++)
+		{
+			const Contact& c = lane[k];
+			float separation = 0.5f * c.penetration;
+			_vx[c.a] += impulse[k] * c.normalX * _inverseMass[c.a];
+			_vy[c.a] += impulse[k] * c.normalY * _inverseMass[c.a];
+			_vx[c.b] -= impulse[k] * c.normalX * _inverseMass[c.b];
+			_vy[c.b] -= impulse[k] * c.normalY * _inverseMass[c.b];
+			_x[c.a] -= separation * c.normalX;
+			_y[c.a] -= separation * c.normalY;
+			_x[c.b] += separation * c.normalX;
+			_y[c.b] += separation * c.normalY;
+			_touched[c.a] = 1;
+			_touched[c.b] = 1;
+		}
+	}
+	for (int i = 0; i < count; i++)
+	{
+		correctContact(_ordered[i]);
+	}
+	// Keep the contacts in the order they were solved
+	_contacts.swap(_ordered);
+}
+
+int ContactSolver::findOpenBatch(int batch)
+{
+	// Full batches point past themselves, halve the path on the way
+	while (_nextOpen[batch] != batch)
+	{
+		_nextOpen[batch] = _nextOpen[_nextOpen[batch]];
+		batch = _nextOpen[batch];
+	}
+	return batch;
+}
+
+void ContactSolver::solveParallel(ThreadPool& pool)
+{
+	int count = static_cast<int>(_contacts.size());
+	// Canonical order, so the colours don't depend on how the broad phase found the pairs
+	std::sort(_contacts.begin(), _contacts.end(), [](const Contact& left, const Contact& right) {
+		return left.a != right.a ? left.a < right.a : left.b < right.b;
+	});
+
+	// Greedy colouring: each contact takes the lowest colour neither of its circles has yet
+	_colourMask.assign(_x.size(), 0);
+	_colourOf.resize(count);
+	_colourStart.assign(MAX_COLOURS + 2, 0);
+	_colourCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const Contact& c = _contacts[i];
+		std::uint64_t used = _colourMask[c.a] | _colourMask[c.b];
+		int colour = MAX_COLOURS;
+		if (used != ~std::uint64_t(0))
+		{
+			colour = 0;
+			while (used & (std::uint64_t(1) << colour))
+			{
+				colour++;
+			}
+			_colourMask[c.a] |= std::uint64_t(1) << colour;
+			_colourMask[c.b] |= std::uint64_t(1) << colour;
+		}
+		_colourOf[i] = colour;
+		_colourStart[colour + 1]++;
+		_colourCount = std::max(_colourCount, colour + 1);
+	}
+	for (int colour = 0; colour <= MAX_COLOURS; colour++)
+	{
+		_colourStart[colour + 1] += _colourStart[colour];
+	}
+	_ordered.resize(count);
+	_fill.assign(_colourStart.begin(), _colourStart.end() - 1);
+	for (int i = 0; i < count; i++)
+	{
+		_ordered[_fill[_colourOf[i]]++] = _contacts[i];
+	}
+
+	// Contacts of one colour touch disjoint circles, so their order and thread don't matter
+	int first = 0;
+	auto solveRange = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			applyContact(_ordered[first + i]);
+		}
+	};
+	for (int colour = 0; colour < MAX_COLOURS; colour++)
+	{
+		first = _colourStart[colour];
+		pool.parallelFor(_colourStart[colour + 1] - first, PARALLEL_GRAIN, solveRange);
+	}
+	for (int i = _colourStart[MAX_COLOURS]; i < count; i++)
+	{
+		applyContact(_ordered[i]);
+	}
+	// The correction pass in the same colours, against the positions the solve left
+	auto correctRange = [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			correctContact(_ordered[first + i]);
+		}
+	};
+	for (int colour = 0; colour < MAX_COLOURS; colour++)
+	{
+		first = _colourStart[colour];
+		pool.parallelFor(_colourStart[colour + 1] - first, PARALLEL_GRAIN, correctRange);
+	}
+	for (int i = _colourStart[MAX_COLOURS]; i < count; i++)
+	{
+		correctContact(_ordered[i]);
+	}
+	// Keep the contacts in the order they were solved
+	_contacts.swap(_ordered);
+}
+
+void ContactSolver::applyContact(const Contact& c)
+{
+	float relative = (_vx[c.b] - _vx[c.a]) * c.normalX + (_vy[c.b] - _vy[c.a]) * c.normalY;
+	float impulse = c.impulseScale * relative;
+	_vx[c.a] += impulse * c.normalX * _inverseMass[c.a];
+	_vy[c.a] += impulse * c.normalY * _inverseMass[c.a];
+	_vx[c.b] -= impulse * c.normalX * _inverseMass[c.b];
+	_vy[c.b] -= impulse * c.normalY * _inverseMass[c.b];
+	float separation = 0.5f * c.penetration;
+	_x[c.a] -= separation * c.normalX;
+	_y[c.a] -= separation * c.normalY;
+	_x[c.b] += separation * c.normalX;
+	_y[c.b] += separation * c.normalY;
+	_touched[c.a] = 1;
+	_touched[c.b] = 1;
+}
+
+void ContactSolver::correctContact(const Contact& c)
+{
+	// Positions only, the impulse was already applied
+	float dx = _x[c.b] - _x[c.a];
+	float dy = _y[c.b] - _y[c.a];
+	float distanceSquared = dx * dx + dy * dy;
+	float radii = _radius[c.a] + _radius[c.b];
+	if (distanceSquared >= radii * radii)
+	{
+		return;
+	}
+	float distance = std::sqrt(distanceSquared);
+	float normalX = distance > 0.0f ? dx / distance : c.normalX;
+	float normalY = distance > 0.0f ? dy / distance : c.normalY;
+	float separation = 0.5f * (radii - distance);
+	_x[c.a] -= separation * normalX;
+	_y[c.a] -= separation * normalY;
+	_x[c.b] += separation * normalX;
+	_y[c.b] += separation * normalY;
+}
+
+void ContactSolver::scatter(std::vector<std::shared_ptr<MyCircle>>& circles, bool recolor)
+{
+	// Untouched circles are left alone, a round trip through pixels could move them
+	for (std::size_t i = 0; i < circles.size(); i++)
+	{
+		if (!_touched[i])
+		{
+			continue;
+		}
+		MyCircle& circle = *circles[i];
+		circle.setPositionFromMetersToPixels(_x[i], _y[i]);
+		circle.setVelocity(sf::Vector2f(_vx[i], _vy[i]));
+		if (recolor)
+		{
+			circle.randomizeColor();
+		}
+	}
+}
+
+int ContactSolver::getContactCount() const
+{
+	return static_cast<int>(_contacts.size());
+}
+
+const std::vector<ContactSolver::Contact>& ContactSolver::getContacts() const
+{
+	return _contacts;
+}
+
+int ContactSolver::getColourCount() const
+{
+	return _colourCount;
+}
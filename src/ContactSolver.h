@@ -0,0 +1,76 @@
+#pragma once
+#include "MyCircle.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Circle contacts over flat arrays. gather copies circle state into meters
+// once per step, addPair runs the narrow phase on a candidate and appends a
+// contact with its normal and overlap, solve applies the contacts, and
+// scatter writes the state back and applies the colour side effects.
+// The impulse and the separation use the normal and overlap addPair found
+// at the start of the step. Earlier contacts may have moved the circles
+// since, so a correction pass then takes each pair from the current
+// positions and pushes apart the ones still overlapping, skipping pairs
+// that already separated. solve packs the contacts into batches of BATCH
+// lanes that share no circle, keeping every circle's contacts in their
+// order, and commits all lanes of a batch together. solveParallel sorts the
+// contacts by pair and colours them so no two of one colour share a circle,
+// then solves colour by colour on the pool: the result doesn't depend on
+// the thread count.
+class ContactSolver
+{
+public:
+	struct Contact
+	{
+		int a;
+		int b;
+		// (1 + restitution) over the effective mass
+		float impulseScale;
+		// From a to b and the overlap along it, as addPair found them
+		float normalX;
+		float normalY;
+		float penetration;
+	};
+	static constexpr int BATCH = 8;
+	// Colours tracked per circle, contacts past them go to one serial colour
+	static constexpr int MAX_COLOURS = 64;
+	ContactSolver();
+	// Grows the per-circle arrays ahead of gather, where circles are created
+	void reserve(int count);
+	void gather(const std::vector<std::shared_ptr<MyCircle>>& circles);
+	bool addPair(int a, int b);
+	void solve();
+	void solveParallel(ThreadPool& pool);
+	void scatter(std::vector<std::shared_ptr<MyCircle>>& circles, bool recolor);
+	// Overlapping pairs the last solve applied
+	int getContactCount() const;
+	// In the order they were solved
+	const std::vector<Contact>& getContacts() const;
+	// Colours used by the last solveParallel
+	int getColourCount() const;
+private:
+	std::vector<float> _x;
+	std::vector<float> _y;
+	std::vector<float> _vx;
+	std::vector<float> _vy;
+	std::vector<float> _mass;
+	std::vector<float> _inverseMass;
+	std::vector<float> _radius;
+	std::vector<unsigned char> _touched;
+	std::vector<Contact> _contacts;
+	std::vector<std::uint64_t> _colourMask;
+	std::vector<int> _colourOf;
+	std::vector<int> _colourStart;
+	std::vector<int> _fill;
+	std::vector<Contact> _ordered;
+	std::vector<int> _lastBatch;
+	std::vector<int> _batchOf;
+	std::vector<int> _batchStart;
+	std::vector<int> _nextOpen;
+	int _colourCount;
+	void applyContact(const Contact& contact);
+	void correctContact(const Contact& contact);
+	int findOpenBatch(int batch);
+};
@@ -0,0 +1,85 @@
+#include "Counters.h"
+#ifdef RSS_PROFILING
+#include <fstream>
+
+std::atomic<std::int64_t> Counters::_current[Counters::COUNTER_COUNT];
+std::int64_t Counters::_lastFrame[Counters::COUNTER_COUNT];
+std::int64_t Counters::_frameIndex = 0;
+
+namespace
+{
+	const char* counterNames[Counters::COUNTER_COUNT] =
+	{
+		"BroadPhasePairs",
+		"IntersectTests",
+		"Contacts",
+		"NeighbourRebuilds",
+		"TextTests",
+		"DrawCalls",
+		"Vertices",
+		"TargetSwitches",
+		"BloomPasses"
+	};
+	std::ofstream csv;
+}
+
+void Counters::add(Counter counter, std::int64_t amount)
+{
+	_current[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+std::int64_t Counters::get(Counter counter)
+{
+	return _lastFrame[counter];
+}
+
+const char* Counters::getName(Counter counter)
+{
+	return counterNames[counter];
+}
+
+void Counters::endFrame()
+{
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		_lastFrame[i] = _current[i].exchange(0, std::memory_order_relaxed);
+	}
+	if (csv.is_open())
+	{
+		csv << _frameIndex;
+		for (int i = 0; i < COUNTER_COUNT; i++)
+		{
+			csv << "," << _lastFrame[i];
+		}
+		csv << "\n";
+	}
+	_frameIndex++;
+}
+
+bool Counters::startCsv(const std::string& path)
+{
+	csv.open(path);
+	if (!csv)
+	{
+		return false;
+	}
+	csv << "frame";
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		csv << "," << counterNames[i];
+	}
+	csv << "\n";
+	return true;
+}
+
+void Counters::stopCsv()
+{
+	csv.close();
+}
+
+bool Counters::isCsvActive()
+{
+	return csv.is_open();
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+// Per-frame work counters shown next to the profiler zones. Like the zones
+// they only exist when RSS_PROFILING is defined.
+#ifdef RSS_PROFILING
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define PROFILE_COUNT(counter, amount) Counters::add(counter, amount)
+
+class Counters
+{
+public:
+	enum Counter
+	{
+		BroadPhasePairs,
+		IntersectTests,
+		Contacts,
+		NeighbourRebuilds,
+		TextTests,
+		DrawCalls,
+		Vertices,
+		TargetSwitches,
+		BloomPasses,
+		COUNTER_COUNT
+	};
+	static void add(Counter counter, std::int64_t amount);
+	static std::int64_t get(Counter counter);
+	static const char* getName(Counter counter);
+	static void endFrame();
+	static bool startCsv(const std::string& path);
+	static void stopCsv();
+	static bool isCsvActive();
+private:
+	static std::atomic<std::int64_t> _current[COUNTER_COUNT];
+	static std::int64_t _lastFrame[COUNTER_COUNT];
+	static std::int64_t _frameIndex;
+};
+
+#else
+
+#define PROFILE_COUNT(counter, amount)
+
+#endif
@@ -0,0 +1,261 @@
+#include "CpuBloom.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Rows or columns per pool task
+	const int ROW_GRAIN = 16;
+	const int COLUMN_GRAIN = 64;
+	// Per thread scratch for the horizontal passes, two rows of RGBA
+	thread_local std::vector<sf::Uint8> rowScratch;
+
+	// Box averages divide by a 16.16 reciprocal, the sums of a 255 wide
+	// radius stay far below overflow
+	inline int reciprocal(int radius)
+	{
+		return (65536 + radius) / (2 * radius + 1);
+	}
+
+	// One box pass along a row, edges clamped like the GPU's texture sampling.
+	// The four channels run side by side so the inner loops vectorise
+	void boxRow(const sf::Uint8* source, sf::Uint8* destination, int width, int radius)
+	{
+		int scale = reciprocal(radius);
+		int sums[4];
+		for (int c = 0; c < 4; c++)
+		{
+			sums[c] = (radius + 1) * source[c];
+			for (int i = 1; i <= radius; i++)
+			{
+				sums[c] += source[std::min(i, width - 1) * 4 + c];
+			}
+		}
+		// Clamped reads only near the ends, the middle slides without bounds checks
+		int interiorBegin = std::min(radius, width);
+		int interiorEnd = std::max(interiorBegin, width - radius - 1);
+		auto clamped = [&](int x) {
+			const sf::Uint8* add = source + std::min(x + radius + 1, width - 1) * 4;
+			const sf::Uint8* remove = source + std::max(x - radius, 0) * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				destination[x * 4 + c] = static_cast<sf::Uint8>((sums[c] * scale + 32768) >> 16);
+				sums[c] += add[c] - remove[c];
+			}
+		};
+		for (int x = 0; x < interiorBegin; x++)
+		{
+			clamped(x);
+		}
+		for (int x = interiorBegin; x < interiorEnd; x++)
+		{
+			const sf::Uint8* add = source + (x + radius + 1) * 4;
+			const sf::Uint8* remove = source + (x - radius) * 4;
+			sf::Uint8* out = destination + x * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				out[c] = static_cast<sf::Uint8>((sums[c] * scale + 32768) >> 16);
+				sums[c] += add[c] - remove[c];
+			}
+		}
+		for (int x = interiorEnd; x < width; x++)
+		{
+			clamped(x);
+		}
+	}
+
+	// One box pass down a slice of columns. The running sums of every column
+	// in the slice advance a whole row at a time, so memory is read in rows
+	void boxColumns(const sf::Uint8* source, sf::Uint8* destination, int first, int count, int height, int stride, int radius, std::vector<int>& sums)
+	{
+		int scale = reciprocal(radius);
+		sums.resize(count);
+		// A plain pointer, stores through out can't be assumed to miss the vector itself
+		int* sum = sums.data();
+		const sf::Uint8* top = source + first;
+		for (int k = 0; k < count; k++)
+		{
+			sum[k] = (radius + 1) * top[k];
+		}
+		for (int i = 1; i <= radius; i++)
+		{
+			const sf::Uint8* row = source + static_cast<size_t>(std::min(i, height - 1)) * stride + first;
+			for (int k = 0; k < count; k++)
+			{
+				sum[k] += row[k];
+			}
+		}
+		for (int y = 0; y < height; y++)
+		{
+			sf::Uint8* out = destination + static_cast<size_t>(y) * stride + first;
+			const sf::Uint8* add = source + static_cast<size_t>(std::min(y + radius + 1, height - 1)) * stride + first;
+			const sf::Uint8* remove = source + static_cast<size_t>(std::max(y - radius, 0)) * stride + first;
+			for (int k = 0; k < count; k++)
+			{
+				out[k] = static_cast<sf::Uint8>((sum[k] * scale + 32768) >> 16);
+				sum[k] += add[k] - remove[k];
+			}
+		}
+	}
+}
+
+CpuBloom::Parameters::Parameters() :
+	sigma(5.0f),
+	glow(1.0f),
+	strength(2.0f),
+	exposure(2.0f),
+	intensity(0.15f),
+	vignette(0.3f)
+{
+}
+
+CpuBloom::CpuBloom()
+{
+	setParameters(Parameters());
+}
+
+void CpuBloom::setParameters(const Parameters& parameters)
+{
+	_parameters = parameters;
+	// 1 - exp(-x * exposure) in 8-bit units for every reachable scene + bloom * strength
+	int entries = static_cast<int>(std::ceil(255.0f * (1.0f + std::max(0.0f, parameters.strength)) * TONEMAP_STEPS)) + 1;
+	_tonemap.resize(entries);
+	for (int i = 0; i < entries; i++)
+	{
+		float color = static_cast<float>(i) / (TONEMAP_STEPS * 255.0f);
+		float mapped = parameters.exposure > 0.0f ? 1.0f - std::exp(-color * parameters.exposure) : std::min(color, 1.0f);
+		_tonemap[i] = mapped * 255.0f;
+	}
+}
+
+void CpuBloom::computeRadii(float sigma)
+{
+	// Box widths whose three-fold convolution has the gaussian's variance
+	float variance = 12.0f * sigma * sigma;
+	float ideal = std::sqrt(variance / BOX_PASSES + 1.0f);
+	int lower = static_cast<int>(std::floor(ideal));
+	if (lower % 2 == 0)
+	{
+		lower--;
+	}
+	lower = std::max(lower, 1);
+	int upper = lower + 2;
+	int lowerCount = static_cast<int>(std::round((variance - BOX_PASSES * lower * lower - 4 * BOX_PASSES * lower - 3 * BOX_PASSES) / (-4.0f * lower - 4.0f)));
+	for (int i = 0; i < BOX_PASSES; i++)
+	{
+		int width = i < lowerCount ? lower : upper;
+		_radii[i] = (width - 1) / 2;
+	}
+}
+
+void CpuBloom::apply(std::vector<sf::Uint8>& pixels, sf::Vector2u size, sf::Vector2u screenSize, ThreadPool& pool)
+{
+	PROFILE_SCOPE("CpuBloom");
+	if (size.x == 0 || size.y == 0)
+	{
+		return;
+	}
+	computeRadii(_parameters.sigma * size.x / screenSize.x);
+	_bloom.resize(pixels.size());
+	_temp.resize(pixels.size());
+	// The vignette's horizontal half only depends on the column
+	_columnShade.resize(size.x);
+	for (unsigned int x = 0; x < size.x; x++)
+	{
+		float edgeX = (x + 0.5f) / size.x - 0.5f;
+		_columnShade[x] = _parameters.vignette * edgeX * edgeX * 4.0f;
+	}
+
+	// pixels -> _temp by rows, _temp -> _bloom by columns, then composited back into pixels
+	auto rows = [&](int begin, int end) {
+		blurRows(pixels, begin, end, size);
+	};
+	pool.parallelFor(static_cast<int>(size.y), ROW_GRAIN, rows);
+	auto columns = [&](int begin, int end) {
+		blurColumns(begin, end, size);
+	};
+	pool.parallelFor(static_cast<int>(size.x), COLUMN_GRAIN, columns);
+	auto compose = [&](int begin, int end) {
+		composite(pixels, begin, end, size, screenSize);
+	};
+	pool.parallelFor(static_cast<int>(size.y), ROW_GRAIN, compose);
+}
+
+void CpuBloom::blurRows(const std::vector<sf::Uint8>& pixels, int rowBegin, int rowEnd, sf::Vector2u size)
+{
+	int width = static_cast<int>(size.x);
+	rowScratch.resize(static_cast<size_t>(width) * 8);
+	sf::Uint8* front = rowScratch.data();
+	sf::Uint8* back = front + width * 4;
+	for (int y = rowBegin; y < rowEnd; y++)
+	{
+		size_t offset = static_cast<size_t>(y) * width * 4;
+		sf::Uint8* row = &_temp[offset];
+		boxRow(&pixels[offset], front, width, _radii[0]);
+		boxRow(front, back, width, _radii[1]);
+		boxRow(back, row, width, _radii[2]);
+		applyGlow(row, width * 4);
+	}
+}
+
+void CpuBloom::blurColumns(int columnBegin, int columnEnd, sf::Vector2u size)
+{
+	thread_local std::vector<int> sums;
+	int stride = static_cast<int>(size.x) * 4;
+	int height = static_cast<int>(size.y);
+	int first = columnBegin * 4;
+	int count = (columnEnd - columnBegin) * 4;
+	boxColumns(_temp.data(), _bloom.data(), first, count, height, stride, _radii[0], sums);
+	boxColumns(_bloom.data(), _temp.data(), first, count, height, stride, _radii[1], sums);
+	boxColumns(_temp.data(), _bloom.data(), first, count, height, stride, _radii[2], sums);
+	for (int y = 0; y < height; y++)
+	{
+		applyGlow(&_bloom[static_cast<size_t>(y) * stride + first], count);
+	}
+}
+
+void CpuBloom::applyGlow(sf::Uint8* values, int count) const
+{
+	// The GPU blur targets are 8-bit too, the glow saturates the same way
+	if (_parameters.glow == 1.0f)
+	{
+		return;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		values[i] = static_cast<sf::Uint8>(std::min(values[i] * _parameters.glow + 0.5f, 255.0f));
+	}
+}
+
+void CpuBloom::composite(std::vector<sf::Uint8>& pixels, int rowBegin, int rowEnd, sf::Vector2u size, sf::Vector2u screenSize) const
+{
+	// combine, tonemap and scanline as Combine.glsl, Tonemap.glsl and Scanline.glsl fuse them.
+	// Table index of scene + bloom * strength in 24.8 fixed point
+	int sceneScale = TONEMAP_STEPS * 256;
+	int bloomScale = static_cast<int>(std::max(0.0f, _parameters.strength) * TONEMAP_STEPS * 256.0f + 0.5f);
+	int alphaScale = static_cast<int>(std::max(0.0f, _parameters.strength) * 256.0f + 0.5f);
+	int last = static_cast<int>(_tonemap.size()) - 1;
+	const float* tonemap = _tonemap.data();
+	const float* columnShade = _columnShade.data();
+	for (int y = rowBegin; y < rowEnd; y++)
+	{
+		float v = (y + 0.5f) / size.y;
+		float line = static_cast<float>(static_cast<int>(std::floor(v * screenSize.y)) % 2);
+		float rowShade = 1.0f - _parameters.intensity * line;
+		float edgeY = v - 0.5f;
+		float rowVignette = 1.0f - _parameters.vignette * edgeY * edgeY * 4.0f;
+		sf::Uint8* pixel = &pixels[static_cast<size_t>(y) * size.x * 4];
+		const sf::Uint8* bloom = &_bloom[static_cast<size_t>(y) * size.x * 4];
+		for (unsigned int x = 0; x < size.x; x++, pixel += 4, bloom += 4)
+		{
+			float shade = std::max(0.0f, rowShade * (rowVignette - columnShade[x]));
+			for (int c = 0; c < 3; c++)
+			{
+				int index = std::min((pixel[c] * sceneScale + bloom[c] * bloomScale + 128) >> 8, last);
+				pixel[c] = static_cast<sf::Uint8>(std::min(tonemap[index] * shade, 255.0f) + 0.5f);
+			}
+			pixel[3] = static_cast<sf::Uint8>(std::min(pixel[3] + ((bloom[3] * alphaScale + 128) >> 8), 255));
+		}
+	}
+}
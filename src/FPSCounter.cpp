@@ -1,14 +1,38 @@
 #include "FPSCounter.h"
 #include "GameManager.h"
+#include "HSV.h"
+#include "Profiler.h"
+#include "Counters.h"
+#include "AllocTracker.h"
+#include <cstdio>
+
+const std::uint64_t FPSCounter::RECENT_FRAMES = 120;
+
+namespace
+{
+	// Overwrites a fixed-width string, padding with spaces that draw nothing
+	void writeFixed(sf::String& target, const char* text)
+	{
+		for (sf::String::Iterator out = target.begin(); out != target.end(); ++out)
+		{
+			*out = *text ? static_cast<sf::Uint32>(*text++) : static_cast<sf::Uint32>(' ');
+		}
+	}
+}
 
 FPSCounter::FPSCounter(float x, float y, float z, float w, sf::Font& font) :
-	_colorTransitionSpeed(400),
+	_fpsString(std::string(TEXT_WIDTH, ' ')),
+	_objectsString(std::string(TEXT_WIDTH, ' ')),
+	_profileVisible(false),
+	_profileFrameCounter(0),
+	_recentIndex(0),
+	_frameCounter(0),
 	_deltaFrames(20.0f),
 	_deltaFrames1(20.0f),
-	_frameCounter(0),
 	_hue(0),
 	_sat(0.0f),
-	_val(1.0f)
+	_val(1.0f),
+	_colorTransitionSpeed(400)
 {
 	_fpsText = std::make_shared<sf::Text>();
 	_objectsText = std::make_shared<sf::Text>();
@@ -18,14 +42,36 @@ FPSCounter::FPSCounter(float x, float y, float z, float w, sf::Font& font) :
 	_objectsText->setPosition(z, w);
 	_fpsText->setCharacterSize(20);
 	_objectsText->setCharacterSize(20);
-	sf::Color color(HSVtoRGB(this->_hue, this->_sat, this->_val));
+	sf::Color color(HSV::toRGB(this->_hue, this->_sat, this->_val));
 	_fpsText->setFillColor(color);
 	_objectsText->setFillColor(color);
+	_fpsId = _batch.add(*_fpsText, color);
+	_objectsId = _batch.add(*_objectsText, color);
+
+	// Per-phase breakdown: zone name, current, average and max ms, allocations, then the work counters
+	const float columnX[PROFILE_COLUMNS] = { 0.0f, 220.0f, 300.0f, 380.0f, 460.0f, 560.0f };
+	for (int i = 0; i < PROFILE_COLUMNS; i++)
+	{
+		_profileColumns[i].setFont(font);
+		_profileColumns[i].setCharacterSize(16);
+		_profileColumns[i].setPosition(x + columnX[i], y + 30.0f);
+		_profileIds[i] = _batch.add(_profileColumns[i], sf::Color::White);
+	}
 }
 
 
 void FPSCounter::displayFps(float deltaTime)
 {	
+	// Every frame goes into the histograms, the text only refreshes every 20 frames.
+	// Two alternating halves give the overlay a window of the last 120-240 frames.
+	_total.record(deltaTime);
+	_recent[_recentIndex].record(deltaTime);
+	if (_recent[_recentIndex].getCount() >= RECENT_FRAMES)
+	{
+		_recentIndex = 1 - _recentIndex;
+		_recent[_recentIndex].reset();
+	}
+
 	_frameCounter++;
 	if (_frameCounter == _deltaFrames) 
 	{
@@ -33,22 +79,115 @@ void FPSCounter::displayFps(float deltaTime)
 		// restarting the timer
 		sf::Time elapsed = _clock.restart();
 		int fps = _deltaFrames / elapsed.asSeconds();
-		_fpsText->setString("FPS: " + std::to_string(static_cast<int>(fps)));
-		updateColor(fps, deltaTime);
+		_window.reset();
+		_window.merge(_recent[0]);
+		_window.merge(_recent[1]);
+		float p99 = _window.getPercentileMs(99.0f);
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "FPS: %d  P50 %.1f  P95 %.1f  P99 %.1f  P99.9 %.1f  MAX %.1f MS", fps,
+			_window.getPercentileMs(50.0f), _window.getPercentileMs(95.0f), p99, _window.getPercentileMs(99.9f), _window.getMaxMs());
+		writeFixed(_fpsString, buffer);
+		_fpsText->setString(_fpsString);
+		_batch.update(_fpsId, *_fpsText);
+		// Colour follows the slow frames rather than the average
+		updateColor(p99 > 0.0f ? 1000.0f / p99 : fps, deltaTime);
 	}
 }
 
+void FPSCounter::printReport() const
+{
+	std::cout << "FPSCOUNTER: " << _total.getCount() << " frames, frame time ms"
+		<< " p50 " << _total.getPercentileMs(50.0f)
+		<< " p95 " << _total.getPercentileMs(95.0f)
+		<< " p99 " << _total.getPercentileMs(99.0f)
+		<< " p99.9 " << _total.getPercentileMs(99.9f)
+		<< " max " << _total.getMaxMs() << "\n";
+}
+
 void FPSCounter::displayOjbectCount()
 {
 	_frameCounter1++;
 	if (_frameCounter1 == _deltaFrames1)
 	{
 		_frameCounter1 = 0;
-		int objCount = GameManager::getObjectCount();
-		_objectsText->setString("OBJECTS COUNT: " + std::to_string(static_cast<int>(objCount)));
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "OBJECTS COUNT: %d", GameManager::getObjectCount());
+		writeFixed(_objectsString, buffer);
+		_objectsText->setString(_objectsString);
+		_batch.update(_objectsId, *_objectsText);
 	}
 }
 
+void FPSCounter::toggleProfile()
+{
+	_profileVisible = !_profileVisible;
+	_profileFrameCounter = static_cast<int>(_deltaFrames) - 1;
+	if (!_profileVisible)
+	{
+		for (int i = 0; i < PROFILE_COLUMNS; i++)
+		{
+			_profileColumns[i].setString("");
+			_batch.update(_profileIds[i], _profileColumns[i]);
+		}
+	}
+}
+
+void FPSCounter::displayProfile()
+{
+#ifdef RSS_PROFILING
+	if (!_profileVisible)
+	{
+		return;
+	}
+	_profileFrameCounter++;
+	if (_profileFrameCounter < _deltaFrames)
+	{
+		return;
+	}
+	_profileFrameCounter = 0;
+	// The breakdown is diagnostics built from strings, its refreshes don't count against the budget
+	ALLOC_EXEMPT();
+
+	std::string columns[PROFILE_COLUMNS] = { "ZONE\n", "CUR\n", "AVG\n", "MAX\n", "", "COUNTERS\n" };
+#ifdef RSS_TRACK_ALLOCS
+	columns[4] = "ALLOCS\n";
+#endif
+	char buffer[128];
+	for (int zone = 0; zone < Profiler::getZoneCount(); zone++)
+	{
+		Profiler::ZoneStats stats = Profiler::getStats(zone);
+		columns[0] += std::string(stats.depth * 2, ' ') + Profiler::getZoneName(zone) + "\n";
+		std::snprintf(buffer, sizeof(buffer), "%.2f\n", stats.currentMs);
+		columns[1] += buffer;
+		std::snprintf(buffer, sizeof(buffer), "%.2f\n", stats.averageMs);
+		columns[2] += buffer;
+		std::snprintf(buffer, sizeof(buffer), "%.2f\n", stats.maxMs);
+		columns[3] += buffer;
+#ifdef RSS_TRACK_ALLOCS
+		std::snprintf(buffer, sizeof(buffer), "%lld\n", static_cast<long long>(AllocTracker::getZoneStats(zone).allocations));
+		columns[4] += buffer;
+#endif
+	}
+	for (int counter = 0; counter < Counters::COUNTER_COUNT; counter++)
+	{
+		std::snprintf(buffer, sizeof(buffer), "%s %lld\n", Counters::getName(static_cast<Counters::Counter>(counter)),
+			static_cast<long long>(Counters::get(static_cast<Counters::Counter>(counter))));
+		columns[5] += buffer;
+	}
+#ifdef RSS_TRACK_ALLOCS
+	AllocTracker::Stats frame = AllocTracker::getFrameStats();
+	std::snprintf(buffer, sizeof(buffer), "Allocations %lld\nAllocatedBytes %lld\nFrees %lld\n", static_cast<long long>(frame.allocations),
+		static_cast<long long>(frame.bytes), static_cast<long long>(AllocTracker::getFrameFrees()));
+	columns[5] += buffer;
+#endif
+	for (int i = 0; i < PROFILE_COLUMNS; i++)
+	{
+		_profileColumns[i].setString(columns[i]);
+		_batch.update(_profileIds[i], _profileColumns[i]);
+	}
+#endif
+}
+
 void FPSCounter::updateColor(float fps, float deltaTime)
 {
 	if (this->_sat < 1.0f) 
@@ -62,8 +201,8 @@ void FPSCounter::updateColor(float fps, float deltaTime)
 			this->_hue -= std::ceil(_colorTransitionSpeed * deltaTime);
 		}
 		normalizeHSV();
-		sf::Color newColor(HSVtoRGB(this->_hue, this->_sat, this->_val));
-		_fpsText->setFillColor(newColor);
+		sf::Color newColor(HSV::toRGB(this->_hue, this->_sat, this->_val));
+		_batch.setColor(_fpsId, newColor);
 	}
 	else if (fps > 30.0f && fps < 60.0f) 
 	{
@@ -76,8 +215,8 @@ void FPSCounter::updateColor(float fps, float deltaTime)
 			this->_hue += std::ceil(_colorTransitionSpeed * deltaTime);
 		}
 		normalizeHSV();
-		sf::Color newColor(HSVtoRGB(this->_hue, this->_sat, this->_val));
-		_fpsText->setFillColor(newColor);
+		sf::Color newColor(HSV::toRGB(this->_hue, this->_sat, this->_val));
+		_batch.setColor(_fpsId, newColor);
 	}
 	else if (fps > 60.0f && fps < 130.0f) 
 	{
@@ -90,8 +229,8 @@ void FPSCounter::updateColor(float fps, float deltaTime)
 			this->_hue += std::ceil(_colorTransitionSpeed * deltaTime);
 		}
 		normalizeHSV();
-		sf::Color newColor(HSVtoRGB(this->_hue, this->_sat, this->_val));
-		_fpsText->setFillColor(newColor);
+		sf::Color newColor(HSV::toRGB(this->_hue, this->_sat, this->_val));
+		_batch.setColor(_fpsId, newColor);
 	}
 	else if (fps > 130.0f)
 	{
@@ -104,8 +243,8 @@ void FPSCounter::updateColor(float fps, float deltaTime)
 			this->_hue += std::ceil(_colorTransitionSpeed * deltaTime);
 		}
 		normalizeHSV();
-		sf::Color newColor(HSVtoRGB(this->_hue, this->_sat, this->_val));
-		_fpsText->setFillColor(newColor);
+		sf::Color newColor(HSV::toRGB(this->_hue, this->_sat, this->_val));
+		_batch.setColor(_fpsId, newColor);
 	}
 	//std::cout << "Hue= " << (float)this->_hue << "\n";
 }
@@ -136,22 +275,5 @@ void FPSCounter::normalizeHSV()
 
 void FPSCounter::draw(sf::RenderWindow* window)
 {
-	window->draw(*_fpsText);
-	window->draw(*_objectsText);
-}
-sf::Color FPSCounter::HSVtoRGB(float h, float s, float v) 
-{
-	int hi = static_cast<int>(h / 60) % 6;
-	float f = h / 60 - std::floor(h / 60);
-	float p = v * (1 - s);
-	float q = v * (1 - f * s);
-	float t = v * (1 - (1 - f) * s);
-	switch (hi) {
-	case 0: return sf::Color(static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(t * 255), static_cast<sf::Uint8>(p * 255));
-	case 1: return sf::Color(static_cast<sf::Uint8>(q * 255), static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(p * 255));
-	case 2: return sf::Color(static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(t * 255));
-	case 3: return sf::Color(static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(q * 255), static_cast<sf::Uint8>(v * 255));
-	case 4: return sf::Color(static_cast<sf::Uint8>(t * 255), static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(v * 255));
-	default: return sf::Color(static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(q * 255));
-	}
+	window->draw(_batch);
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "SFML/Graphics.hpp"
+#include "TextBatch.h"
+#include "FrameHistogram.h"
 #include <iostream>
 class FPSCounter 
 {
@@ -8,9 +10,31 @@ public:
 	void draw(sf::RenderWindow* window);
 	void displayFps(float deltaTime);
 	void displayOjbectCount();
+	void displayProfile();
+	void toggleProfile();
+	void printReport() const;
 private:
 	std::shared_ptr<sf::Text> _fpsText;
 	std::shared_ptr<sf::Text> _objectsText;
+	// Fixed-width copies of the two lines, rewritten in place so sf::Text can
+	// take them over into its own buffer without allocating
+	static const int TEXT_WIDTH = 96;
+	sf::String _fpsString;
+	sf::String _objectsString;
+	TextBatch _batch;
+	int _fpsId;
+	int _objectsId;
+	bool _profileVisible;
+	int _profileFrameCounter;
+	static const int PROFILE_COLUMNS = 6;
+	sf::Text _profileColumns[PROFILE_COLUMNS];
+	int _profileIds[PROFILE_COLUMNS];
+	static const std::uint64_t RECENT_FRAMES;
+	FrameHistogram _total;
+	FrameHistogram _recent[2];
+	// Both halves merged for the overlay, kept so a refresh doesn't allocate
+	FrameHistogram _window;
+	int _recentIndex;
 	sf::Clock _clock;
 	int _frameCounter;
 	float _deltaFrames;
@@ -18,7 +42,6 @@ private:
 	float _deltaFrames1;
 	void updateColor(float fps, float deltaTime);
 	void normalizeHSV();
-	sf::Color HSVtoRGB(float h, float s, float v);
 	int _hue;
 	float _sat;
 	float _val;
@@ -0,0 +1,330 @@
+#include "FrameCapture.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+FrameCapture::FrameCapture(const std::string& path, sf::Vector2u size, int rate) :
+	_path(path),
+	_size(size),
+	_rate(std::max(1, rate)),
+	_format(Y4m),
+	_file(nullptr),
+	_pipe(false),
+	_open(false),
+	_finished(false),
+	_captured(0),
+	_readBack(0),
+	_stopping(false),
+	_stalls(0),
+	_captureSeconds(0.0f),
+	_writeFailed(false),
+	_writeSeconds(0.0f)
+{
+	if (!_target.create(size.x, size.y))
+	{
+		std::cout << "CAPTURE: failed to create a " << size.x << "x" << size.y << " render texture" << "\n";
+		return;
+	}
+	_ring.resize(RING_SIZE);
+	for (sf::Texture& texture : _ring)
+	{
+		if (!texture.create(size.x, size.y))
+		{
+			std::cout << "CAPTURE: failed to create a " << size.x << "x" << size.y << " texture" << "\n";
+			return;
+		}
+	}
+	if (!openOutput())
+	{
+		return;
+	}
+	_open = true;
+	_writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	finish();
+}
+
+bool FrameCapture::isOpen() const
+{
+	return _open;
+}
+
+sf::Vector2u FrameCapture::getSize() const
+{
+	return _size;
+}
+
+int FrameCapture::getFrameCount() const
+{
+	return _captured;
+}
+
+bool FrameCapture::openOutput()
+{
+	if (!_path.empty() && _path[0] == '|')
+	{
+#ifdef _WIN32
+		_file = _popen(_path.c_str() + 1, "wb");
+#else
+		_file = popen(_path.c_str() + 1, "w");
+#endif
+		_pipe = true;
+	}
+	else if (_path.size() > 4 && _path.compare(_path.size() - 4, 4, ".y4m") == 0)
+	{
+		_file = std::fopen(_path.c_str(), "wb");
+	}
+	else
+	{
+		_format = Sequence;
+		if (formatSequenceName(0).empty())
+		{
+			std::cout << "CAPTURE: " << _path << " needs a frame number such as %05d, or use a .y4m file or a |command" << "\n";
+			return false;
+		}
+		return true;
+	}
+	if (!_file)
+	{
+		std::cout << "CAPTURE: failed to open " << _path << "\n";
+		return false;
+	}
+	// Progressive 4:2:0 with chroma centred between the luma samples it averages
+	std::fprintf(_file, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", _size.x, _size.y, _rate);
+	return true;
+}
+
+void FrameCapture::closeOutput()
+{
+	if (!_file)
+	{
+		return;
+	}
+	if (_pipe)
+	{
+#ifdef _WIN32
+		_pclose(_file);
+#else
+		pclose(_file);
+#endif
+	}
+	else
+	{
+		std::fclose(_file);
+	}
+	_file = nullptr;
+}
+
+sf::RenderTarget& FrameCapture::getTarget()
+{
+	return _target;
+}
+
+void FrameCapture::capture()
+{
+	if (!_open || _finished)
+	{
+		return;
+	}
+	sf::Clock clock;
+	// The slot about to be reused was copied RING_SIZE frames ago, its readback doesn't wait on the GPU
+	if (_captured - _readBack == RING_SIZE)
+	{
+		readBack();
+	}
+	_target.display();
+	_ring[_captured % RING_SIZE].update(_target.getTexture());
+	_captured++;
+	_captureSeconds += clock.getElapsedTime().asSeconds();
+}
+
+void FrameCapture::readBack()
+{
+	PROFILE_SCOPE("CaptureReadback");
+	sf::Image image = _ring[_readBack % RING_SIZE].copyToImage();
+	std::vector<sf::Uint8> pixels;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (static_cast<int>(_queue.size()) >= QUEUE_LIMIT)
+		{
+			// The writer is behind, wait rather than drop frames from the video
+			_stalls++;
+			_written.wait(lock, [this] { return static_cast<int>(_queue.size()) < QUEUE_LIMIT; });
+		}
+		if (!_spare.empty())
+		{
+			pixels.swap(_spare.back());
+			_spare.pop_back();
+		}
+	}
+	const sf::Uint8* source = image.getPixelsPtr();
+	pixels.assign(source, source + static_cast<size_t>(_size.x) * _size.y * 4);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(Frame());
+		_queue.back().index = _readBack;
+		_queue.back().pixels.swap(pixels);
+	}
+	_queued.notify_one();
+	_readBack++;
+}
+
+bool FrameCapture::finish()
+{
+	if (!_open)
+	{
+		return false;
+	}
+	if (_finished)
+	{
+		return !_writeFailed;
+	}
+	_finished = true;
+	while (_readBack < _captured)
+	{
+		readBack();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_queued.notify_one();
+	_writer.join();
+	closeOutput();
+
+	std::cout << "CAPTURE: " << _captured << " frames at " << _size.x << "x" << _size.y << ", " << _rate << " fps to " << _path << "\n";
+	if (_captured > 0)
+	{
+		std::cout << "CAPTURE: " << _captureSeconds * 1000.0f / _captured << " ms per frame on the render thread, "
+			<< _writeSeconds * 1000.0f / _captured << " ms on the writer, " << _stalls << " stalls on a full queue" << "\n";
+	}
+	if (_writeFailed)
+	{
+		std::cout << "CAPTURE: writing " << _path << " failed" << "\n";
+	}
+	return !_writeFailed;
+}
+
+void FrameCapture::writerLoop()
+{
+#ifdef RSS_PROFILING
+	Profiler::setThreadName("CaptureWriter");
+#endif
+	while (true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_queued.wait(lock, [this] { return _stopping || !_queue.empty(); });
+			if (_queue.empty())
+			{
+				return;
+			}
+			frame.index = _queue.front().index;
+			frame.pixels.swap(_queue.front().pixels);
+			_queue.pop_front();
+		}
+		// After a failed write the rest are only drained, capture must not block on them
+		if (!_writeFailed)
+		{
+			PROFILE_SCOPE("CaptureWrite");
+			sf::Clock clock;
+			_writeFailed = !(_format == Y4m ? writeY4m(frame) : writeImage(frame));
+			_writeSeconds += clock.getElapsedTime().asSeconds();
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_spare.push_back(std::vector<sf::Uint8>());
+			_spare.back().swap(frame.pixels);
+		}
+		_written.notify_one();
+	}
+}
+
+bool FrameCapture::writeY4m(const Frame& frame)
+{
+	// BT.601 studio range, what players assume for Y4M without colour tags
+	unsigned int width = _size.x;
+	unsigned int height = _size.y;
+	unsigned int chromaWidth = (width + 1) / 2;
+	unsigned int chromaHeight = (height + 1) / 2;
+	size_t lumaSize = static_cast<size_t>(width) * height;
+	size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+	_planes.resize(lumaSize + 2 * chromaSize);
+	sf::Uint8* luma = _planes.data();
+	sf::Uint8* blue = luma + lumaSize;
+	sf::Uint8* red = blue + chromaSize;
+	const sf::Uint8* pixels = frame.pixels.data();
+	for (size_t i = 0; i < lumaSize; i++)
+	{
+		const sf::Uint8* pixel = pixels + i * 4;
+		luma[i] = static_cast<sf::Uint8>(((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16);
+	}
+	// Each chroma sample averages a 2x2 block, odd edges repeat their last row or column
+	for (unsigned int cy = 0; cy < chromaHeight; cy++)
+	{
+		unsigned int y0 = cy * 2;
+		unsigned int y1 = std::min(y0 + 1, height - 1);
+		for (unsigned int cx = 0; cx < chromaWidth; cx++)
+		{
+			unsigned int x0 = cx * 2;
+			unsigned int x1 = std::min(x0 + 1, width - 1);
+			const sf::Uint8* block[4] = {
+				pixels + (static_cast<size_t>(y0) * width + x0) * 4,
+				pixels + (static_cast<size_t>(y0) * width + x1) * 4,
+				pixels + (static_cast<size_t>(y1) * width + x0) * 4,
+				pixels + (static_cast<size_t>(y1) * width + x1) * 4
+			};
+			int r = (block[0][0] + block[1][0] + block[2][0] + block[3][0] + 2) >> 2;
+			int g = (block[0][1] + block[1][1] + block[2][1] + block[3][1] + 2) >> 2;
+			int b = (block[0][2] + block[1][2] + block[2][2] + block[3][2] + 2) >> 2;
+			size_t index = static_cast<size_t>(cy) * chromaWidth + cx;
+			blue[index] = static_cast<sf::Uint8>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			red[index] = static_cast<sf::Uint8>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+	std::fputs("FRAME\n", _file);
+	return std::fwrite(_planes.data(), 1, _planes.size(), _file) == _planes.size();
+}
+
+bool FrameCapture::writeImage(Frame& frame)
+{
+	// Alpha is whatever the blending left in the back buffer, the files should be opaque
+	for (size_t i = 3; i < frame.pixels.size(); i += 4)
+	{
+		frame.pixels[i] = 255;
+	}
+	sf::Image image;
+	image.create(_size.x, _size.y, frame.pixels.data());
+	return image.saveToFile(formatSequenceName(frame.index));
+}
+
+std::string FrameCapture::formatSequenceName(int index) const
+{
+	// The pattern's one printf style number, %d or %0<width>d
+	size_t percent = _path.find('%');
+	if (percent == std::string::npos)
+	{
+		return "";
+	}
+	size_t end = percent + 1;
+	bool zeros = end < _path.size() && _path[end] == '0';
+	int width = 0;
+	while (end < _path.size() && _path[end] >= '0' && _path[end] <= '9')
+	{
+		width = width * 10 + (_path[end] - '0');
+		end++;
+	}
+	if (end >= _path.size() || _path[end] != 'd')
+	{
+		return "";
+	}
+	std::ostringstream name;
+	name << _path.substr(0, percent) << std::setfill(zeros ? '0' : ' ') << std::setw(width) << index << _path.substr(end + 1);
+	return name.str();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Video export without a screen recorder. The final pass is drawn into
+// getTarget(), a texture at the capture size, and capture() copies it into a
+// ring of textures on the GPU. Only the slot copied RING_SIZE frames earlier
+// is read back, the GPU has long finished it, so the render loop never waits
+// on the frame in flight. Pixels go to a writer thread that encodes them
+// while the next frames render.
+// Outputs: "name.y4m" for one YUV 4:2:0 stream, "|command" for the same stream
+// on a pipe (e.g. "|ffmpeg -i - out.mp4"), or a numbered sequence such as
+// "frames/%05d.png" in any format sf::Image can save.
+class FrameCapture
+{
+public:
+	FrameCapture(const std::string& path, sf::Vector2u size, int rate);
+	~FrameCapture();
+	bool isOpen() const;
+	sf::Vector2u getSize() const;
+	// Where the frame's final pass goes instead of the window
+	sf::RenderTarget& getTarget();
+	// Queues what was drawn into the target
+	void capture();
+	// Reads back what is left in the ring and waits for the writer to drain,
+	// false when the output could not be written
+	bool finish();
+	int getFrameCount() const;
+private:
+	static const int RING_SIZE = 3;
+	// Frames queued for the writer before capture blocks on it
+	static const int QUEUE_LIMIT = 8;
+	enum Format
+	{
+		Y4m,
+		Sequence
+	};
+	struct Frame
+	{
+		int index;
+		std::vector<sf::Uint8> pixels;
+	};
+	std::string _path;
+	sf::Vector2u _size;
+	int _rate;
+	Format _format;
+	std::FILE* _file;
+	bool _pipe;
+	bool _open;
+	bool _finished;
+	sf::RenderTexture _target;
+	std::vector<sf::Texture> _ring;
+	int _captured;
+	int _readBack;
+	std::thread _writer;
+	std::mutex _mutex;
+	std::condition_variable _queued;
+	std::condition_variable _written;
+	std::deque<Frame> _queue;
+	// Written frames' buffers, reused so a long capture settles at QUEUE_LIMIT allocations
+	std::vector<std::vector<sf::Uint8>> _spare;
+	bool _stopping;
+	int _stalls;
+	float _captureSeconds;
+	// The writer's own, read once it has joined
+	bool _writeFailed;
+	float _writeSeconds;
+	std::vector<sf::Uint8> _planes;
+	bool openOutput();
+	void closeOutput();
+	void readBack();
+	void writerLoop();
+	bool writeY4m(const Frame& frame);
+	bool writeImage(Frame& frame);
+	std::string formatSequenceName(int index) const;
+};
@@ -0,0 +1,108 @@
+#include "FrameHistogram.h"
+#include <algorithm>
+
+const int FrameHistogram::SUB_BUCKET_BITS = 6;
+const int FrameHistogram::SUB_BUCKET_HALF = 32;
+// 16.7 s, anything longer lands in the last bucket
+const std::uint32_t FrameHistogram::MAX_VALUE_US = (1u << 24) - 1;
+
+FrameHistogram::FrameHistogram() :
+	_buckets(bucketIndex(MAX_VALUE_US) + 1, 0),
+	_count(0),
+	_maxUs(0)
+{
+}
+
+void FrameHistogram::record(float seconds)
+{
+	float us = seconds * 1000000.0f;
+	std::uint32_t value = us <= 0.0f ? 0 : (us >= MAX_VALUE_US ? MAX_VALUE_US : static_cast<std::uint32_t>(us));
+	_buckets[bucketIndex(value)]++;
+	_count++;
+	if (value > _maxUs)
+	{
+		_maxUs = value;
+	}
+}
+
+void FrameHistogram::merge(const FrameHistogram& other)
+{
+	for (size_t i = 0; i < _buckets.size(); i++)
+	{
+		_buckets[i] += other._buckets[i];
+	}
+	_count += other._count;
+	if (other._maxUs > _maxUs)
+	{
+		_maxUs = other._maxUs;
+	}
+}
+
+void FrameHistogram::reset()
+{
+	std::fill(_buckets.begin(), _buckets.end(), 0);
+	_count = 0;
+	_maxUs = 0;
+}
+
+float FrameHistogram::getPercentileMs(float percentile) const
+{
+	if (_count == 0)
+	{
+		return 0.0f;
+	}
+	// Rank of the sample at the percentile, 1-based
+	std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0f * _count + 0.5f);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	std::uint64_t seen = 0;
+	for (size_t i = 0; i < _buckets.size(); i++)
+	{
+		seen += _buckets[i];
+		if (seen >= rank)
+		{
+			std::uint32_t highest = bucketHighest(static_cast<int>(i));
+			return (highest < _maxUs ? highest : _maxUs) / 1000.0f;
+		}
+	}
+	return getMaxMs();
+}
+
+float FrameHistogram::getMaxMs() const
+{
+	return _maxUs / 1000.0f;
+}
+
+std::uint64_t FrameHistogram::getCount() const
+{
+	return _count;
+}
+
+int FrameHistogram::bucketIndex(std::uint32_t valueUs)
+{
+	// Below 64 us every microsecond has its own bucket
+	if (valueUs < (1u << SUB_BUCKET_BITS))
+	{
+		return static_cast<int>(valueUs);
+	}
+	int msb = 0;
+	while ((valueUs >> (msb + 1)) != 0)
+	{
+		msb++;
+	}
+	int shift = msb - (SUB_BUCKET_BITS - 1);
+	return shift * SUB_BUCKET_HALF + static_cast<int>(valueUs >> shift);
+}
+
+std::uint32_t FrameHistogram::bucketHighest(int index)
+{
+	if (index < (1 << SUB_BUCKET_BITS))
+	{
+		return static_cast<std::uint32_t>(index);
+	}
+	int shift = index / SUB_BUCKET_HALF - 1;
+	std::uint32_t sub = static_cast<std::uint32_t>(index - shift * SUB_BUCKET_HALF);
+	return ((sub + 1) << shift) - 1;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Log-bucketed frame time histogram in microseconds. Each power of two is split
+// into 32 linear sub-buckets, so any recorded value is within ~3% of its bucket.
+class FrameHistogram
+{
+public:
+	FrameHistogram();
+	void record(float seconds);
+	void merge(const FrameHistogram& other);
+	void reset();
+	float getPercentileMs(float percentile) const;
+	float getMaxMs() const;
+	std::uint64_t getCount() const;
+private:
+	static const int SUB_BUCKET_BITS;
+	static const int SUB_BUCKET_HALF;
+	static const std::uint32_t MAX_VALUE_US;
+	std::vector<std::uint32_t> _buckets;
+	std::uint64_t _count;
+	std::uint32_t _maxUs;
+	static int bucketIndex(std::uint32_t valueUs);
+	static std::uint32_t bucketHighest(int index);
+};
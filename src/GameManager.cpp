@@ -1,42 +1,81 @@
 #include "GameManager.h"
 #include "MyText.h"
 #include "FPSCounter.h"
-static bool introComplete = false;
-bool GameManager::add = false;
-bool isMousePressed = false;
-bool bloomEnabled = true;
-uint32_t quantity = 1000;
-float timeSinceLastSpawn = 0.05f;
-float spawnInterval = 0.01f;
-uint32_t spwnCount = 0;
-int OBJCOUNT = 0;
+#include "Profiler.h"
+#include "Counters.h"
+#include "AllocTracker.h"
+#include "Config.h"
+#include <SFML/OpenGL.hpp>
+// Started during static initialisation, close enough to process start for the startup report
+static sf::Clock startupClock;
+const int GLYPHS_PER_FRAME = 16;
+// Fixed-rate physics catches up at most this many steps per frame, then drops the backlog
+const int MAX_PHYSICS_STEPS = 4;
+// Radial blast at the cursor, in meters, and its push at the centre like a shake
+const float BLAST_RADIUS = 12.0f;
+const float BLAST_STRENGTH = 1000.0f;
 
 
 GameManager::GameManager(sf::RenderWindow* window, std::shared_ptr<sf::Font> font) :
+    add(false),
+    _world(World::current()),
+    _config(&Config::get()),
+    _renderScale(Config::get().renderScale, Config::get().autoRenderScale, Config::get().frameBudgetMs),
     _window(window),
+    maxZoom(2.0f),
     Physics(),
-    _font(font),
     _fpsCounter(0.0f, 0.0f, 100.0f, 0.0f, *font),
+    _font(font),
+    _fixedDt(0.0f),
+    _physicsAccumulator(0.0f),
+    _running(true),
+    _input(nullptr),
+    _mousePosition(0, 0),
+    _glyphWarmup(0),
+    _firstFrameShown(false),
+    _postProcessReady(false),
+    _mousePressed(false),
+    _bloomEnabled(Config::get().bloom),
+    _timeSinceLastSpawn(0.05f),
+    _spawnCount(0),
     _circs(),
     _texts(),
-    maxZoom(2.0f)
+    _gridStale(false),
+    _contactLog(nullptr),
+    _capture(nullptr)
 {
-    // Init shaders
-    shaders = std::make_shared<Shaders>(window);
-
-    view = _window->getDefaultView();
+    // Without a window the game runs headless: simulation only, sized like the world's display
+    sf::Vector2u windowSize = _world.getSize();
+    if (_window)
+    {
+        windowSize = _window->getSize();
+    }
+    view = sf::View(sf::FloatRect(0.0f, 0.0f, static_cast<float>(windowSize.x), static_cast<float>(windowSize.y)));
+    _windowSize = windowSize;
 
     float offsetXPercent = 0.05f;
     float offsetYPercent = 0.05f;
 
-    _width = _window->getSize().x / Settings::getConversionFactor();
-    _height = _window->getSize().y / Settings::getConversionFactor(); 
+    _width = windowSize.x / Settings::getConversionFactor();
+    _height = windowSize.y / Settings::getConversionFactor(); 
 
     _offsetX = _width * offsetXPercent;
     _offsetY = _height * offsetYPercent;
 
+    _hoverRing.setFillColor(sf::Color::Transparent);
+    _hoverRing.setOutlineColor(sf::Color(255, 255, 255, 160));
+    _hoverRing.setOutlineThickness(1.5f);
+
+    if (!_window)
+    {
+        showIntro();
+        return;
+    }
+
+    // Scene renders at the internal resolution and is upscaled once on output
+    sf::Vector2u sceneSize = _renderScale.apply(_window->getSize());
     renderTexture = std::make_shared<sf::RenderTexture>();
-    if (!renderTexture->create(_window->getSize().x, _window->getSize().y))
+    if (!renderTexture->create(sceneSize.x, sceneSize.y))
     {
         std::cout << "GAMEMANAGER: Failed to create RenderTexture" << "\n";
     }
@@ -45,37 +84,251 @@ GameManager::GameManager(sf::RenderWindow* window, std::shared_ptr<sf::Font> fon
         std::cout << "GAMEMANAGER: RenderTexture created - SUCCESS" << "\n";
         std::cout << "CRITICAL: Ruslan.exe stopped working. Please contact your local Ruslan provider to get a replacement." << "\n";
     }
+    renderTexture->setSmooth(true);
+
+    // Init shaders
+    shaders = std::make_shared<Shaders>(window, sceneSize, Config::get().bloomQuality);
+    _cpuBloom.setParameters(shaders->getBloomParameters());
 
     showIntro();    
-    run();    
 }
 
 bool GameManager::isIntroFinished()
 {
-    return introComplete;
+    return World::current().introComplete;
 }
 
 int GameManager::getObjectCount()
 {
-    return OBJCOUNT;
+    return World::current().objectCount;
 }
 
 void GameManager::run()
 {
-    while (_window->isOpen()) 
+    while (_running && (!_window || _window->isOpen())) 
     {
         _dt = _clock.restart();
-        float deltaTime = _dt.asSeconds();
-        if (!introComplete) 
+        step(_fixedDt > 0.0f ? _fixedDt : _dt.asSeconds());
+    }
+    if (_input)
+    {
+        _input->finish(getStateHash());
+    }
+    _fpsCounter.printReport();
+    if (_neighbours.getStepCount() > 0)
+    {
+        std::cout << "NEIGHBOURS: rebuilt on " << _neighbours.getRebuildCount() << " of " << _neighbours.getStepCount() << " steps, "
+            << _neighbours.getPairCount() << " pairs listed" << "\n";
+    }
+}
+
+void GameManager::step(float deltaTime)
+{
+    if (_world.isPrimary())
+    {
+        Config::poll();
+    }
+    if (_config != &Config::get())
+    {
+        const Config::Values* previous = _config;
+        _config = &Config::get();
+        applyConfig(*previous);
+    }
+    {
+        PROFILE_SCOPE("Frame");
+        if (!_world.introComplete) 
         {
+            PROFILE_SCOPE("Intro");
             intro(deltaTime); 
+            warmUpGlyphs(GLYPHS_PER_FRAME);
+        }
+        if (_window || _input)
+        {
+            handleInput(deltaTime);
         }
-       
-        handleInput(deltaTime);
         update(deltaTime);
-        draw(deltaTime);
+        if (_window)
+        {
+            draw(deltaTime);
+        }
         disposeTrash();
     }
+    // Frame statistics are process-wide, only the primary world closes a frame
+    if (_world.isPrimary())
+    {
+        PROFILE_FRAME();
+        ALLOC_FRAME();
+    }
+}
+
+bool GameManager::isHeadless() const
+{
+    return _window == nullptr;
+}
+
+void GameManager::setRenderScale(float scale)
+{
+    _renderScale.setFixed(scale);
+    if (_window)
+    {
+        resizeRenderTargets();
+    }
+}
+
+void GameManager::setFixedTimestep(float dt)
+{
+    _fixedDt = dt;
+}
+
+void GameManager::setInputRecorder(InputRecorder* input)
+{
+    _input = input;
+}
+
+void GameManager::setContactLog(std::vector<std::pair<int, int>>* log)
+{
+    _contactLog = log;
+}
+
+void GameManager::setFrameCapture(FrameCapture* capture)
+{
+    _capture = capture;
+}
+
+bool GameManager::isPostProcessSettled() const
+{
+    return shaders->isReady() || shaders->hasFailed();
+}
+
+const std::vector<std::shared_ptr<MyCircle>>& GameManager::getCircles() const
+{
+    return _circs;
+}
+
+std::uint64_t GameManager::getStateHash() const
+{
+    // FNV-1a over the exact bits of every circle, equal hashes mean a bit-identical world
+    std::uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    std::uint64_t count = _circs.size();
+    mix(&count, sizeof(count));
+    for (const auto& circPtr : _circs)
+    {
+        sf::Vector2f position = circPtr->_circle->getPosition();
+        sf::Vector2f velocity = circPtr->getVelocity();
+        float radius = circPtr->_circle->getRadius();
+        mix(&position, sizeof(position));
+        mix(&velocity, sizeof(velocity));
+        mix(&radius, sizeof(radius));
+    }
+    return hash;
+}
+
+bool GameManager::isAtCircleLimit() const
+{
+    int maxCircles = Config::get().maxCircles;
+    return maxCircles > 0 && static_cast<int>(_circs.size()) >= maxCircles;
+}
+
+void GameManager::applyConfig(const Config::Values& previous)
+{
+    // Only what GameManager holds as state, everything else reads Config directly
+    const Config::Values& current = *_config;
+    if (current.bloom != previous.bloom)
+    {
+        _bloomEnabled = current.bloom;
+    }
+    if (!_window)
+    {
+        return;
+    }
+    if (current.frameCap != previous.frameCap)
+    {
+        _window->setFramerateLimit(current.frameCap);
+    }
+    if (current.autoRenderScale != previous.autoRenderScale || current.renderScale != previous.renderScale
+        || current.frameBudgetMs != previous.frameBudgetMs)
+    {
+        if (current.autoRenderScale)
+        {
+            _renderScale.setAutomatic(current.frameBudgetMs);
+        }
+        else
+        {
+            _renderScale.setFixed(current.renderScale);
+        }
+        resizeRenderTargets();
+    }
+    if (current.bloomQuality != previous.bloomQuality)
+    {
+        // Recompiles in the background, the frame skips post-processing meanwhile
+        shaders = std::make_shared<Shaders>(_window, renderTexture->getSize(), current.bloomQuality);
+        _cpuBloom.setParameters(shaders->getBloomParameters());
+    }
+}
+
+void GameManager::spawnCircles(int count)
+{
+    ALLOC_EXEMPT();
+    for (int i = 0; i < count && !isAtCircleLimit(); i++)
+    {
+        _circs.emplace_back(std::make_shared<MyCircle>());
+    }
+    reserveCircleStorage();
+}
+
+void GameManager::reserveCircleStorage()
+{
+    // The physics arrays sized per circle grow with the spawn, not in the next step
+    int capacity = static_cast<int>(_circs.capacity());
+    _grid.reserve(_circs, Physics._width, Physics._height);
+    _neighbours.reserve(capacity);
+    _solver.reserve(capacity);
+}
+
+void GameManager::toggleGravity()
+{
+    // Its notice, string included, is created on purpose
+    ALLOC_EXEMPT();
+    Physics.toggleGravity();
+    if (Physics.getGravityState())
+    {
+        showNotice("GRAVITY ENABLED", sf::Color::Green);
+    }
+    else
+    {
+        showNotice("GRAVITY DISABLED", sf::Color::Red);
+    }
+}
+
+void GameManager::shake()
+{
+    // Its notice, string included, is created on purpose
+    ALLOC_EXEMPT();
+    for (auto& circPtr : _circs) 
+    {
+        circPtr->randomizeVelocity();
+    }
+    showNotice("SHAKE", sf::Color::Magenta);
+}
+
+void GameManager::clear()
+{
+    _circs.clear();
+    _grabbed.reset();
+    _hovered.reset();
+}
+
+void GameManager::showNotice(const std::string& text, sf::Color color)
+{
+    ALLOC_EXEMPT();
+    _texts.emplace_back(std::make_shared<MyText>(text, _width / 2, _height - 15 * _offsetY, *_font, _texts, color, true));
 }
 
 void GameManager::keyboardInput(float deltaTime, sf::Event event)
@@ -84,59 +337,83 @@ void GameManager::keyboardInput(float deltaTime, sf::Event event)
         {
             if (event.key.code == sf::Keyboard::B)
             {
-                bloomEnabled = !bloomEnabled;
-                if (bloomEnabled)
+                _bloomEnabled = !_bloomEnabled;
+                if (_bloomEnabled)
                 {
                     std::string state = "BLOOM ENABLED";
-                    _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Cyan, true));
+                    showNotice(state, sf::Color::Cyan);
                 }
                 else
                 {
                     std::string state = "BLOOM DISABLED";
-                    _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Cyan, true));
+                    showNotice(state, sf::Color::Cyan);
                 }
             }
+            else if (event.key.code == sf::Keyboard::P)
+            {
+                _fpsCounter.toggleProfile();
+            }
+            else if (event.key.code == sf::Keyboard::T)
+            {
+#ifdef RSS_PROFILING
+                Profiler::requestTraceDump();
+#endif
+            }
+            else if (event.key.code == sf::Keyboard::C)
+            {
+#ifdef RSS_PROFILING
+                std::string state;
+                if (Counters::isCsvActive())
+                {
+                    Counters::stopCsv();
+                    state = "COUNTERS CSV STOPPED";
+                }
+                else if (Counters::startCsv("counters.csv"))
+                {
+                    state = "COUNTERS CSV STARTED";
+                }
+                else
+                {
+                    state = "COUNTERS CSV FAILED";
+                }
+                showNotice(state, sf::Color::Yellow);
+#endif
+            }
+            else if (event.key.code == sf::Keyboard::U)
+            {
+                cycleRenderScale();
+            }
             else if (event.key.code == sf::Keyboard::M)
             {
                     add = !add;
             }
             else if (event.key.code == sf::Keyboard::Escape)
             {
-                _window->close();
+                _running = false;
+                if (_window)
+                {
+                    _window->close();
+                }
             }
             else if (event.key.code == sf::Keyboard::X)
             {
-                _circs.clear();
+                clear();
             }
             else if (event.key.code == sf::Keyboard::H)
             {
-                for (int i = 0; i < 20; i++)
-                {
-                    _circs.emplace_back(std::make_shared<MyCircle>());
-                }
+                spawnCircles(20);
             }
             else if (event.key.code == sf::Keyboard::R)
             {
-                for (auto& circPtr : _circs) 
-                {
-                    circPtr->randomizeVelocity();
-                    std::string state = "SHAKE";
-                    _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Magenta, true));
-                }
+                shake();
             }
             else if (event.key.code == sf::Keyboard::G)
             {
-                Physics.toggleGravity();
-                if (Physics.getGravityState())
-                {
-                    std::string state = "GRAVITY ENABLED";
-                    _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Green, true));
-                }
-                else
-                {
-                    std::string state = "GRAVITY DISABLED";
-                    _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Red, true));
-                }
+                toggleGravity();
+            }
+            else if (event.key.code == sf::Keyboard::F)
+            {
+                blast(mouseInMeters());
             }
             else if (event.type == sf::Event::KeyPressed) {
                 if (event.key.code == sf::Keyboard::A) {
@@ -159,7 +436,7 @@ void GameManager::mouseInput(float deltaTime, sf::Event event)
 {
     if (event.type == event.MouseWheelScrolled) 
     {
-        sf::Vector2f mousePosF((float)sf::Mouse::getPosition().x, (float)sf::Mouse::getPosition().y);
+        sf::Vector2f mousePosF((float)_mousePosition.x, (float)_mousePosition.y);
         //view.setCenter(mousePosF);
 
         // Zooming in/out
@@ -186,18 +463,35 @@ void GameManager::mouseInput(float deltaTime, sf::Event event)
     }
     if (event.type == event.MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left)
     {
-        isMousePressed = true;
+        _mousePressed = true;
     }
     else if (event.type == event.MouseButtonReleased && event.mouseButton.button == sf::Mouse::Left)
     {
-        isMousePressed = false;
+        _mousePressed = false;
 
     }
+    else if (event.type == event.MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right)
+    {
+        grab();
+    }
+    else if (event.type == event.MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right)
+    {
+        release(deltaTime);
+    }
 }
 
 void GameManager::disposeTrash()
 {
-    // Text
+    PROFILE_SCOPE("Dispose");
+    // Text, the batch entries go first: remove_if leaves moved-from pointers behind
+    for (auto& textPtr : _texts)
+    {
+        if (textPtr->isSafeToRemove() && textPtr->getBatchId() >= 0)
+        {
+            _textBatch.remove(textPtr->getBatchId());
+            textPtr->setBatchId(-1);
+        }
+    }
     auto iteratorToRemove = std::remove_if(_texts.begin(), _texts.end(),
         [](std::shared_ptr<MyText>& textPtr) {
             return textPtr->isSafeToRemove();
@@ -212,8 +506,42 @@ void GameManager::disposeTrash()
 
 void GameManager::handleInput(float deltaTime)
 {
-    sf::Event event;
-    while (_window->pollEvent(event))
+    PROFILE_SCOPE("Input");
+    bool replaying = _input && _input->isReplaying();
+    _frameEvents.clear();
+    if (_window)
+    {
+        sf::Event event;
+        while (_window->pollEvent(event))
+        {
+            // During a replay the live keyboard can only stop it
+            if (replaying)
+            {
+                if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape)
+                {
+                    _running = false;
+                    _window->close();
+                }
+                continue;
+            }
+            _frameEvents.push_back(event);
+        }
+        _mousePosition = sf::Mouse::getPosition(*_window);
+    }
+
+    if (replaying)
+    {
+        if (!_input->replayFrame(_frameEvents, _mousePosition))
+        {
+            _running = false;
+            return;
+        }
+    }
+    else if (_input && _input->isRecording())
+    {
+        _input->recordFrame(_frameEvents, _mousePosition);
+    }
+    for (const sf::Event& event : _frameEvents)
     {
         keyboardInput(deltaTime, event);
         mouseInput(deltaTime, event);
@@ -222,104 +550,556 @@ void GameManager::handleInput(float deltaTime)
     
 void GameManager::update(float deltaTime)
 {
-    spawnOnMouseClick(deltaTime);
-    OBJCOUNT = _circs.size();
-    if (!_circs.empty())
+    PROFILE_SCOPE("Update");
+    {
+        PROFILE_SCOPE("Spawn");
+        spawnOnMouseClick(deltaTime);
+    }
+    if (_grabbed)
+    {
+        holdGrabbed(deltaTime);
+    }
+    _world.objectCount = _circs.size();
+
+    float physicsRate = Config::get().physicsRate;
+    if (physicsRate <= 0.0f)
+    {
+        simulate(deltaTime);
+    }
+    else
+    {
+        float physicsDt = 1.0f / physicsRate;
+        _physicsAccumulator += deltaTime;
+        int steps = 0;
+        while (_physicsAccumulator >= physicsDt && steps < MAX_PHYSICS_STEPS)
+        {
+            simulate(physicsDt);
+            _physicsAccumulator -= physicsDt;
+            steps++;
+        }
+        if (steps == MAX_PHYSICS_STEPS)
+        {
+            _physicsAccumulator = 0.0f;
+        }
+    }
+
+    if (_window)
     {
+        PROFILE_SCOPE("Hover");
+        refreshGrid();
+        int hovered = _grid.pick(mouseInMeters());
+        _hovered = hovered >= 0 ? _circs[hovered] : nullptr;
+    }
+
+    if (!_texts.empty())
+    {
+        PROFILE_SCOPE("TextUpdate");
+        for (auto& textPtr : _texts)
+        {
+            textPtr->updateText(deltaTime);
+        }
+    }
+}
+
+void GameManager::simulate(float deltaTime)
+{
+    const Config::Values& config = Config::get();
+    bool attraction = Physics.getGravityState() && config.gravity == "attraction";
+    if (config.broadPhase == "none" && config.solver == "reference" && !attraction)
+    {
+        simulateReference(deltaTime);
+        return;
+    }
+
+    // Integration, circle pairs and text collisions run as separate passes
+    // so each shows up as its own zone
+    {
+        PROFILE_SCOPE("Physics");
+        Physics.integrate(_circs, deltaTime);
         for (size_t i = 0; i < _circs.size(); ++i)
         {
-             Physics.applyPhysics(_circs[i], deltaTime);
             _circs[i]->updateColor(deltaTime);
-            for (size_t j = i + 1; j < _circs.size(); ++j)
+        }
+    }
+    {
+        PROFILE_SCOPE("BroadPhase");
+        if (config.broadPhase == "verlet")
+        {
+            bool rebuild = _neighbours.needsRebuild(_circs, config.skin);
+            if (rebuild)
             {
-                if (_circs[i]->isIntersect(*_circs[j]))
-                {
-                    Physics.resolveCollision(_circs[i], _circs[j]);
-                }
+                _grid.build(_circs, Physics._width, Physics._height, config.skin);
+                _neighbours.build(_circs, _grid, config.skin);
+                PROFILE_COUNT(Counters::NeighbourRebuilds, 1);
             }
-
-            // Text intersections
-            if (!_texts.empty())
+            _neighbours.countStep(rebuild);
+            _gridStale = !rebuild;
+        }
+        else
+        {
+            _grid.build(_circs, Physics._width, Physics._height);
+            _gridStale = false;
+        }
+    }
+    if (config.solver != "reference")
+    {
+        collideBatched();
+    }
+    else
+    {
+        collide();
+    }
+    if (!_texts.empty())
+    {
+        PROFILE_SCOPE("TextCollisions");
+        std::int64_t textTests = 0;
+        sf::Vector2f normal;
+        float penetration;
+        for (size_t i = 0; i < _circs.size(); ++i)
+        {
+            for (auto& textPtr : _texts)
             {
-                for (auto& textPtr : _texts)
+                if (textPtr->getCollisionsState())
                 {
-                    if (textPtr->getCollisionsState() && textPtr->isIntersect(_circs[i]))
+                    textTests++;
+                    if (textPtr->getContact(*_circs[i], normal, penetration))
                     {
-                        Physics.resolveTextCollision(_circs[i], textPtr);
+                        Physics.resolveTextCollision(_circs[i], textPtr, normal, penetration);
                     }
                 }
             }
         }
+        PROFILE_COUNT(Counters::TextTests, textTests);
     }
+}
 
-    if (!_texts.empty())
+void GameManager::simulateReference(float deltaTime)
+{
+    // The original order: integrate a circle, collide it with the circles after it
+    // (not yet moved this step), then with the texts. Every other backend is checked
+    // against this path, and its phases interleave, so the loop is a single zone
+    PROFILE_SCOPE("Physics");
+    std::int64_t tests = 0;
+    std::int64_t contacts = 0;
+    std::int64_t textTests = 0;
+    sf::Vector2f normal;
+    float penetration;
+    for (size_t i = 0; i < _circs.size(); ++i)
     {
+        Physics.integrate(_circs[i], deltaTime);
+        _circs[i]->updateColor(deltaTime);
+        for (size_t j = i + 1; j < _circs.size(); ++j)
+        {
+            tests++;
+            if (_circs[i]->isIntersect(*_circs[j]))
+            {
+                Physics.resolveCollision(_circs[i], _circs[j]);
+                contacts++;
+                if (_contactLog)
+                {
+                    _contactLog->emplace_back(static_cast<int>(i), static_cast<int>(j));
+                }
+            }
+        }
         for (auto& textPtr : _texts)
         {
-            textPtr->updateText(deltaTime);
+            if (textPtr->getCollisionsState())
+            {
+                textTests++;
+                if (textPtr->getContact(*_circs[i], normal, penetration))
+                {
+                    Physics.resolveTextCollision(_circs[i], textPtr, normal, penetration);
+                }
+            }
         }
     }
+    // No grid was built, the mouse queries rebuild it on demand
+    _gridStale = true;
+    PROFILE_COUNT(Counters::BroadPhasePairs, tests);
+    PROFILE_COUNT(Counters::IntersectTests, tests);
+    PROFILE_COUNT(Counters::Contacts, contacts);
+    PROFILE_COUNT(Counters::TextTests, textTests);
 }
 
-void GameManager::draw(float deltaTime)
+void GameManager::collide()
 {
-    _window->clear(sf::Color::Black);
-    renderTexture->clear(sf::Color::Black);
-    //Physics.drawBound(_window);
-
-    if (bloomEnabled) 
-    {
-        renderTexture->setActive(true);
-        
-        if (!_texts.empty())
+    // Reference path: test and resolve each pair in place through the circles
+    PROFILE_SCOPE("Collisions");
+    std::int64_t tests = 0;
+    std::int64_t contacts = 0;
+    auto collidePair = [&](int i, int j) {
+        tests++;
+        if (_circs[i]->isIntersect(*_circs[j]))
         {
-            for (auto& tPtr : _texts)
+            Physics.resolveCollision(_circs[i], _circs[j]);
+            contacts++;
+            if (_contactLog)
             {
-                MyText& t = *tPtr;
-                renderTexture->draw(*t._text);
+                _contactLog->emplace_back(i, j);
             }
         }
-        if (!_circs.empty())
+    };
+    if (Config::get().broadPhase == "grid")
+    {
+        _grid.forEachCandidatePair(collidePair);
+    }
+    else if (Config::get().broadPhase == "verlet")
+    {
+        _neighbours.forEachPair(collidePair);
+    }
+    else
+    {
+        for (size_t i = 0; i < _circs.size(); ++i)
         {
-            for (auto& cPtr : _circs)
+            for (size_t j = i + 1; j < _circs.size(); ++j)
             {
-                MyCircle& c = *cPtr;
-                renderTexture->draw(*c._circle);
+                collidePair(static_cast<int>(i), static_cast<int>(j));
             }
-        }    
-        shaders->applyBloom(renderTexture);
+        }
     }
-    else 
+    PROFILE_COUNT(Counters::BroadPhasePairs, tests);
+    PROFILE_COUNT(Counters::IntersectTests, tests);
+    PROFILE_COUNT(Counters::Contacts, contacts);
+}
+
+void GameManager::collideBatched()
+{
+    // Gather, narrow phase into a contact array, solve, scatter: one streaming loop each.
+    // Only the parallel solve runs on the pool, the rest stays in circle order
+    PROFILE_SCOPE("Collisions");
+    std::int64_t tests = 0;
     {
-        if (!_texts.empty())
+        PROFILE_SCOPE("NarrowPhase");
+        _solver.gather(_circs);
+        auto addPair = [&](int i, int j) {
+            tests++;
+            _solver.addPair(i, j);
+        };
+        if (Config::get().broadPhase == "grid")
         {
-            for (auto& tPtr : _texts)
-            {
-                MyText& t = *tPtr;
-                _window->draw(*t._text);
-            }
+            _grid.forEachCandidatePair(addPair);
+        }
+        else if (Config::get().broadPhase == "verlet")
+        {
+            _neighbours.forEachPair(addPair);
         }
-        if (!_circs.empty())
+        else
         {
-            for (auto& cPtr : _circs)
+            int count = static_cast<int>(_circs.size());
+            for (int i = 0; i < count; ++i)
             {
-                MyCircle& c = *cPtr;
-                _window->draw(*c._circle);
+                for (int j = i + 1; j < count; ++j)
+                {
+                    addPair(i, j);
+                }
             }
         }
     }
+    {
+        PROFILE_SCOPE("Solve");
+        if (Config::get().solver == "parallel")
+        {
+            _solver.solveParallel(Physics.getPool());
+        }
+        else
+        {
+            _solver.solve();
+        }
+        _solver.scatter(_circs, !Physics.getGravityState());
+    }
+    if (_contactLog)
+    {
+        // Every pair the narrow phase found overlapping, in the order it was solved
+        for (const ContactSolver::Contact& contact : _solver.getContacts())
+        {
+            _contactLog->emplace_back(contact.a, contact.b);
+        }
+    }
+    PROFILE_COUNT(Counters::BroadPhasePairs, tests);
+    PROFILE_COUNT(Counters::IntersectTests, tests);
+    PROFILE_COUNT(Counters::Contacts, _solver.getContactCount());
+}
+
+void GameManager::draw(float deltaTime)
+{
+    PROFILE_SCOPE("Draw");
+    // Sampled frames start from an idle GPU so the clock only covers this frame's work
+    bool sampleGpu = _renderScale.shouldSample();
+    if (sampleGpu)
+    {
+        PROFILE_SCOPE("GpuFence");
+        glFinish();
+    }
+    _gpuClock.restart();
+    _window->clear(sf::Color::Black);
+    renderTexture->clear(sf::Color::Black);
+    renderTexture->setView(view);
+    //Physics.drawBound(_window);
+
+    renderTexture->setActive(true);
+    drawScene();
+
+    // A capture takes the final pass into its own texture, the hidden window behind it shows nothing
+    sf::RenderTarget& output = _capture ? _capture->getTarget() : static_cast<sf::RenderTarget&>(*_window);
+    _window->setView(_window->getDefaultView());
+    if (_bloomEnabled && shaders->hasFailed())
+    {
+        PROFILE_SCOPE("PostProcess");
+        applyCpuBloom(output);
+    }
+    else if (_bloomEnabled && shaders->isReady()) 
+    {
+        PROFILE_SCOPE("PostProcess");
+        shaders->applyPostProcess(renderTexture, output);
+    }
+    else 
+    {
+        renderTexture->display();
+        sf::Sprite scene(renderTexture->getTexture());
+        scene.setScale(static_cast<float>(output.getSize().x) / renderTexture->getSize().x, static_cast<float>(output.getSize().y) / renderTexture->getSize().y);
+        output.draw(scene);
+        PROFILE_COUNT(Counters::TargetSwitches, 1);
+        PROFILE_COUNT(Counters::DrawCalls, 1);
+        PROFILE_COUNT(Counters::Vertices, 4);
+    }
+    if (_capture)
+    {
+        PROFILE_SCOPE("Capture");
+        _capture->capture();
+    }
 
-    _fpsCounter.displayFps(deltaTime);
-    _fpsCounter.displayOjbectCount();
-    _fpsCounter.draw(_window);
-    _window->setView(view);
-    _window->display();
+    {
+        PROFILE_SCOPE("Overlay");
+        _fpsCounter.displayFps(deltaTime);
+        _fpsCounter.displayOjbectCount();
+        _fpsCounter.displayProfile();
+        _fpsCounter.draw(_window);
+    }
+
+    // SFML has no GPU timer queries, the sampled frames fence with glFinish so the clock covers GPU execution
+    if (sampleGpu)
+    {
+        PROFILE_SCOPE("GpuFence");
+        glFinish();
+        if (_renderScale.update(_gpuClock.getElapsedTime().asSeconds() * 1000.0f))
+        {
+            resizeRenderTargets();
+        }
+    }
+    {
+        PROFILE_SCOPE("Display");
+        _window->display();
+    }
+    reportStartup();
 }
 
+void GameManager::reportStartup()
+{
+    if (!_firstFrameShown)
+    {
+        _firstFrameShown = true;
+        std::cout << "STARTUP: first frame after " << startupClock.getElapsedTime().asMilliseconds() << " ms" << "\n";
+    }
+    if (!_postProcessReady && shaders->isReady())
+    {
+        _postProcessReady = true;
+        std::cout << "STARTUP: post-processing live after " << startupClock.getElapsedTime().asMilliseconds() << " ms" << "\n";
+    }
+}
+
+void GameManager::warmUpGlyphs(int count)
+{
+    // Rasterise the glyphs the overlay and notices use a few at a time while the
+    // intro runs, instead of stalling the frame that first shows a new string
+    static const unsigned int SIZES[] = { 16, 20, 30, 35 };
+    const int firstChar = 32;
+    const int charCount = 127 - firstChar;
+    const int total = charCount * static_cast<int>(sizeof(SIZES) / sizeof(SIZES[0]));
+    ALLOC_EXEMPT();
+    for (int i = 0; i < count && _glyphWarmup < total; i++, _glyphWarmup++)
+    {
+        _font->getGlyph(firstChar + _glyphWarmup % charCount, SIZES[_glyphWarmup / charCount], false);
+    }
+}
+
+void GameManager::drawScene()
+{
+    PROFILE_SCOPE("DrawSubmit");
+    PROFILE_COUNT(Counters::TargetSwitches, 1);
+    prepareScene(renderTexture->getSize());
+    if (!_texts.empty())
+    {
+        renderTexture->draw(_textBatch);
+    }
+    if (!_circs.empty())
+    {
+        renderTexture->draw(_circleBatch);
+        drawHover();
+    }
+}
+void GameManager::applyCpuBloom(sf::RenderTarget& output)
+{
+    // The shaders failed: read the scene back, post-process it on the CPU and upscale it to the output
+    renderTexture->display();
+    sf::Image scene = renderTexture->getTexture().copyToImage();
+    sf::Vector2u size = scene.getSize();
+    const sf::Uint8* pixels = scene.getPixelsPtr();
+    _bloomPixels.assign(pixels, pixels + static_cast<size_t>(size.x) * size.y * 4);
+    _cpuBloom.apply(_bloomPixels, size, output.getSize(), Physics.getPool());
+    if (_bloomTexture.getSize() != size)
+    {
+        _bloomTexture.create(size.x, size.y);
+        _bloomTexture.setSmooth(true);
+    }
+    _bloomTexture.update(_bloomPixels.data());
+    sf::Sprite sprite(_bloomTexture);
+    sprite.setScale(static_cast<float>(output.getSize().x) / size.x, static_cast<float>(output.getSize().y) / size.y);
+    output.draw(sprite);
+    PROFILE_COUNT(Counters::TargetSwitches, 1);
+    PROFILE_COUNT(Counters::DrawCalls, 1);
+    PROFILE_COUNT(Counters::Vertices, 4);
+}
+void GameManager::prepareScene(sf::Vector2u targetSize)
+{
+    // Brings both batches up to date, the SFML and the software path draw the same data
+    for (auto& tPtr : _texts)
+    {
+        MyText& t = *tPtr;
+        if (t.getBatchId() < 0)
+        {
+            t.setBatchId(_textBatch.add(*t._text, t.getColor()));
+        }
+        else
+        {
+            _textBatch.setColor(t.getBatchId(), t.getColor());
+        }
+    }
+    // Cull against the pan view and pick tessellation from on-screen size
+    sf::FloatRect viewRect(view.getCenter() - view.getSize() / 2.0f, view.getSize());
+    float pixelsPerUnit = targetSize.x / view.getSize().x;
+    _circleBatch.clear();
+    auto addVisible = [&](MyCircle& c) {
+        if (c.isVisible(viewRect))
+        {
+            c.updateLod(pixelsPerUnit);
+            _circleBatch.add(c);
+        }
+    };
+    if (!_gridStale && _grid.getCount() == static_cast<int>(_circs.size()))
+    {
+        // Only the cells under the view. Collisions moved circles after the build,
+        // by less than a radius, so the box is padded and the bounds test stays exact
+        float factor = Settings::getConversionFactor();
+        float pad = _grid.getMaxRadius();
+        sf::Vector2f min(viewRect.left / factor - pad, viewRect.top / factor - pad);
+        sf::Vector2f max((viewRect.left + viewRect.width) / factor + pad, (viewRect.top + viewRect.height) / factor + pad);
+        _grid.queryRect(min, max, _queryResults);
+        // Cell order to circle order, so circles overlap the same way as before
+        std::sort(_queryResults.begin(), _queryResults.end());
+        for (int i : _queryResults)
+        {
+            addVisible(*_circs[i]);
+        }
+    }
+    else
+    {
+        for (auto& cPtr : _circs)
+        {
+            addVisible(*cPtr);
+        }
+    }
+    _circleBatch.build();
+}
+void GameManager::renderSoftware(SoftwareRenderer& renderer)
+{
+    PROFILE_SCOPE("SoftwareDraw");
+    prepareScene(renderer.getSize());
+    renderer.clear(sf::Color::Black);
+    renderer.setView(view);
+    if (!_texts.empty())
+    {
+        renderer.draw(_textBatch);
+    }
+    if (!_circs.empty())
+    {
+        renderer.draw(_circleBatch);
+    }
+    renderer.render();
+    if (_bloomEnabled)
+    {
+        _cpuBloom.apply(renderer.getPixels(), renderer.getSize(), renderer.getSize(), Physics.getPool());
+    }
+}
+
+void GameManager::drawHover()
+{
+    // Ring around the circle under the cursor, or the one being dragged
+    std::shared_ptr<MyCircle> target = _grabbed ? _grabbed : _hovered;
+    if (!target)
+    {
+        return;
+    }
+    // One shape reused across frames, its vertex arrays only grow with the largest point count seen
+    float radius = target->_circle->getRadius();
+    _hoverRing.setRadius(radius + 2.0f);
+    _hoverRing.setPointCount(target->getLodPointCount());
+    _hoverRing.setOrigin(radius + 2.0f, radius + 2.0f);
+    _hoverRing.setPosition(target->_circle->getPosition());
+    renderTexture->draw(_hoverRing);
+    PROFILE_COUNT(Counters::DrawCalls, 2);
+}
+
+void GameManager::cycleRenderScale()
+{
+    // AUTO -> 100% -> 75% -> 50% -> AUTO
+    std::string state;
+    if (_renderScale.isAutomatic())
+    {
+        _renderScale.setFixed(1.0f);
+    }
+    else if (_renderScale.getScale() > 0.75f)
+    {
+        _renderScale.setFixed(0.75f);
+    }
+    else if (_renderScale.getScale() > 0.5f)
+    {
+        _renderScale.setFixed(0.5f);
+    }
+    else
+    {
+        _renderScale.setAutomatic(Config::get().frameBudgetMs);
+    }
+
+    if (_renderScale.isAutomatic())
+    {
+        state = "RENDER SCALE AUTO";
+    }
+    else
+    {
+        state = "RENDER SCALE " + std::to_string(static_cast<int>(_renderScale.getScale() * 100.0f + 0.5f)) + "%";
+    }
+    showNotice(state, sf::Color::Yellow);
+    resizeRenderTargets();
+}
+
+void GameManager::resizeRenderTargets()
+{
+    sf::Vector2u sceneSize = _renderScale.apply(_window->getSize());
+    if (sceneSize == renderTexture->getSize())
+    {
+        return;
+    }
+    if (!renderTexture->create(sceneSize.x, sceneSize.y))
+    {
+        std::cout << "GAMEMANAGER: Failed to resize RenderTexture" << "\n";
+    }
+    renderTexture->setSmooth(true);
+    shaders->setResolution(sceneSize);
+}
 
 void GameManager::showIntro() 
 {
-    introComplete = false;
+    _world.introComplete = false;
     const std::string& intr = "LEFT CLICK - SPAWN CIRCLES";
     const std::string& intr1 = "B - TOGGLE BLOOM";
     const std::string& intr2 = "G - TOGGLE GRAVITY";
@@ -348,51 +1128,127 @@ bool GameManager::inBoundY()
 }
 void GameManager::spawnOnMouseClick(float deltaTime)
 {
-    if (isMousePressed)
+    if (_mousePressed)
     {
-        timeSinceLastSpawn += deltaTime;
+        _timeSinceLastSpawn += deltaTime;
 
         // Check if enough time has passed to spawn a new circle
-        if (timeSinceLastSpawn >= spawnInterval)
+        if (_timeSinceLastSpawn >= Config::get().spawnInterval && !isAtCircleLimit())
         {
-            sf::Vector2f mousePosF((float)sf::Mouse::getPosition().x, (float)sf::Mouse::getPosition().y);
+            sf::Vector2f mousePosF = mapMouseToWorld();
+            ALLOC_EXEMPT();
             _circs.emplace_back(std::make_shared<MyCircle>(mousePosF));
-            timeSinceLastSpawn = 0.0f;
+            reserveCircleStorage();
+            _timeSinceLastSpawn = 0.0f;
+        }
+    }
+}
+sf::Vector2f GameManager::mapMouseToWorld() const
+{
+    // Same mapping as RenderTarget::mapPixelToCoords with a full-window viewport,
+    // computed from the stored size so headless replays spawn at the same spot
+    sf::Vector2f normalized(-1.0f + 2.0f * _mousePosition.x / _windowSize.x, 1.0f - 2.0f * _mousePosition.y / _windowSize.y);
+    return view.getInverseTransform().transformPoint(normalized);
+}
+sf::Vector2f GameManager::mouseInMeters() const
+{
+    return mapMouseToWorld() / Settings::getConversionFactor();
+}
+void GameManager::refreshGrid()
+{
+    // Spawns and clears between physics steps leave the grid indexing a different vector,
+    // steps that reused the neighbour lists leave it at old positions
+    if (_gridStale || _grid.getCount() != static_cast<int>(_circs.size()))
+    {
+        _grid.build(_circs, Physics._width, Physics._height);
+        _gridStale = false;
+    }
+}
+void GameManager::grab()
+{
+    refreshGrid();
+    int picked = _grid.pick(mouseInMeters());
+    if (picked >= 0)
+    {
+        _grabbed = _circs[picked];
+        _grabLast = mouseInMeters();
+        _grabVelocity = sf::Vector2f(0.0f, 0.0f);
+    }
+}
+void GameManager::holdGrabbed(float deltaTime)
+{
+    // Pinned to the cursor, the throw takes the smoothed cursor speed
+    sf::Vector2f position = mouseInMeters();
+    if (deltaTime > 0.0f)
+    {
+        _grabVelocity = _grabVelocity * 0.5f + (position - _grabLast) * (0.5f / deltaTime);
+    }
+    _grabLast = position;
+    _grabbed->setPositionFromMetersToPixels(position);
+    _grabbed->setVelocity(sf::Vector2f(0.0f, 0.0f));
+    // Moved outside a step, the grid no longer has it where it is
+    _gridStale = true;
+}
+void GameManager::release(float deltaTime)
+{
+    if (_grabbed)
+    {
+        _grabbed->setVelocity(Physics.toEngineVelocity(_grabVelocity, deltaTime));
+        _grabbed.reset();
+    }
+}
+void GameManager::blast(sf::Vector2f center)
+{
+    refreshGrid();
+    _grid.queryRadius(center, BLAST_RADIUS, _queryResults);
+    for (int i : _queryResults)
+    {
+        sf::Vector2f away = _circs[i]->getPositionInMetersFromPixels() - center;
+        float distance = std::sqrt(away.x * away.x + away.y * away.y);
+        if (distance <= 0.0f)
+        {
+            continue;
         }
+        // Linear falloff to nothing at the edge of the blast
+        float push = BLAST_STRENGTH / Settings::getConversionFactor() * std::max(0.0f, 1.0f - distance / BLAST_RADIUS);
+        _circs[i]->accelerate(away * (push / distance));
     }
 }
 void GameManager::intro(float deltaTime)
 {
         float offsetY = _height * 0.1f;
+        const uint32_t quantity = static_cast<uint32_t>(Config::get().introCount);
         float offsetX = _width / quantity;
 
-        timeSinceLastSpawn += deltaTime;
+        _timeSinceLastSpawn += deltaTime;
 
         // Check if enough time has passed to spawn a new circle
-        if (timeSinceLastSpawn >= spawnInterval)
+        if (_timeSinceLastSpawn >= Config::get().introInterval)
         {
-            if (spwnCount < quantity)
+            if (_spawnCount < quantity)
             {
                 sf::Vector2f top;
                 // For the first circle, spawn a bit further from the left edge
-                if (spwnCount == 0)
+                if (_spawnCount == 0)
                 {
-                    top.x = offsetX * spwnCount + 1 * Settings::getConversionFactor(); 
+                    top.x = offsetX * _spawnCount + 1 * Settings::getConversionFactor(); 
                 }
                 // For the last circle, spawn a bit further from the right edge
-                else if (spwnCount == quantity - 1)
+                else if (_spawnCount == quantity - 1)
                 {
-                    top.x = offsetX * spwnCount - 1 * Settings::getConversionFactor(); 
+                    top.x = offsetX * _spawnCount - 1 * Settings::getConversionFactor(); 
                 }
                 else
                 {
-                    top.x = offsetX * spwnCount * Settings::getConversionFactor();
+                    top.x = offsetX * _spawnCount * Settings::getConversionFactor();
                 }
 
                 top.y = -offsetY * 30;
+                ALLOC_EXEMPT();
                 _circs.emplace_back(std::make_shared<MyCircle>(top));
-                timeSinceLastSpawn = 0.0f;
-                spwnCount++;
+                reserveCircleStorage();
+                _timeSinceLastSpawn = 0.0f;
+                _spawnCount++;
             }
             else
             {
@@ -402,16 +1258,15 @@ void GameManager::intro(float deltaTime)
                    {    
                    tPtr->fadeOut();   
                    }
-                   spawnInterval = 0.05f;
-                   timeSinceLastSpawn = 0.05f;
+                   _timeSinceLastSpawn = Config::get().spawnInterval;
                    Physics.toggleGravity();
 
-                   introComplete = true;
+                   _world.introComplete = true;
 
                    if (Physics.getGravityState())
                    {
                        std::string state = "GRAVITY ENABLED";
-                       _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Green, true));
+                       showNotice(state, sf::Color::Green);
                        for (auto& circPtr : _circs)
                        {
                            circPtr->randomizeColor();
@@ -420,7 +1275,7 @@ void GameManager::intro(float deltaTime)
                    else
                    {
                        std::string state = "GRAVITY DISABLED";
-                       _texts.emplace_back(std::make_shared<MyText>(state, _width / 2, _height - 15 * _offsetY, *_font, _texts, sf::Color::Red, true));
+                       showNotice(state, sf::Color::Red);
                        for (auto& circPtr : _circs) 
                        {
                            circPtr->randomizeColor();
@@ -4,20 +4,62 @@
 #include "FPSCounter.h"
 #include "Settings.h"
 #include "Shaders.h"
+#include "RenderScale.h"
+#include "TextBatch.h"
+#include "CircleBatch.h"
+#include "InputRecorder.h"
+#include "Config.h"
+#include "World.h"
+#include "SpatialGrid.h"
+#include "ContactSolver.h"
+#include "NeighbourList.h"
+#include "SoftwareRenderer.h"
+#include "FrameCapture.h"
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <memory>
+#include <utility>
 
 class GameManager
 {
 public:
+	// Belongs to the current world, construct and step it on that world's thread
 	GameManager(sf::RenderWindow* window, std::shared_ptr<sf::Font> font);
 	static bool isIntroFinished();
 	static int getObjectCount();
-	static bool add;
+	bool add;
+	void run();
+	void step(float deltaTime);
+	bool isHeadless() const;
+	void setRenderScale(float scale);
+	void setFixedTimestep(float dt);
+	void setInputRecorder(InputRecorder* input);
+	std::uint64_t getStateHash() const;
+	// Draws the frame's scene on the CPU, no window or GPU needed. Bloom runs on the CPU too
+	void renderSoftware(SoftwareRenderer& renderer);
+	// For solver comparisons: resolved circle pairs are appended to the log until it is reset to nullptr
+	void setContactLog(std::vector<std::pair<int, int>>* log);
+	const std::vector<std::shared_ptr<MyCircle>>& getCircles() const;
+	// Every drawn frame, post-processed and without the overlay, goes to the capture until reset to nullptr
+	void setFrameCapture(FrameCapture* capture);
+	// True once the shaders compiled or failed over to the CPU bloom, the frames look final from then on
+	bool isPostProcessSettled() const;
+	// Actions shared by the keyboard and the scenario runner
+	void spawnCircles(int count);
+	void toggleGravity();
+	void shake();
+	void clear();
 private:
+	World& _world;
+	const Config::Values* _config;
 	std::shared_ptr<Shaders> shaders;
+	// Post-processing when the shaders failed and for software frames
+	CpuBloom _cpuBloom;
+	sf::Texture _bloomTexture;
+	std::vector<sf::Uint8> _bloomPixels;
 	std::shared_ptr<sf::RenderTexture> renderTexture;
+	RenderScale _renderScale;
+	sf::Clock _gpuClock;
 	sf::RenderWindow* _window;
 	sf::View view;
 	float maxZoom;	
@@ -26,8 +68,38 @@ private:
 	std::shared_ptr<sf::Font> _font;
 	sf::Clock _clock;
 	sf::Time _dt;
+	float _fixedDt;
+	float _physicsAccumulator;
+	bool _running;
+	InputRecorder* _input;
+	std::vector<sf::Event> _frameEvents;
+	sf::Vector2i _mousePosition;
+	sf::Vector2u _windowSize;
+	int _glyphWarmup;
+	bool _firstFrameShown;
+	bool _postProcessReady;
+	bool _mousePressed;
+	bool _bloomEnabled;
+	float _timeSinceLastSpawn;
+	uint32_t _spawnCount;
 	std::vector<std::shared_ptr<MyCircle>> _circs;
 	std::vector<std::shared_ptr<MyText>> _texts;
+	TextBatch _textBatch;
+	CircleBatch _circleBatch;
+	// Broad phase for collisions, also answers the mouse queries
+	SpatialGrid _grid;
+	// Verlet broad phase: steps that reuse the lists leave the grid behind
+	NeighbourList _neighbours;
+	bool _gridStale;
+	ContactSolver _solver;
+	std::vector<std::pair<int, int>>* _contactLog;
+	FrameCapture* _capture;
+	std::vector<int> _queryResults;
+	std::shared_ptr<MyCircle> _grabbed;
+	std::shared_ptr<MyCircle> _hovered;
+	sf::CircleShape _hoverRing;
+	sf::Vector2f _grabLast;
+	sf::Vector2f _grabVelocity;
 	float _offsetX;
 	float _offsetY;
 	float _width;
@@ -35,12 +107,34 @@ private:
 	void handleInput(float deltaTime);
 	void intro(float deltaTime);
 	void update(float dt);
+	void simulate(float dt);
+	void simulateReference(float dt);
+	void reserveCircleStorage();
+	void collide();
+	void collideBatched();
 	void draw(float deltaTime);
-	void run();
+	void drawScene();
+	void prepareScene(sf::Vector2u targetSize);
+	void applyCpuBloom(sf::RenderTarget& output);
 	void keyboardInput(float deltaTime, sf::Event);
 	void mouseInput(float deltaTime, sf::Event);
 	void disposeTrash();
 	void showIntro();
 	bool inBoundY();
 	void spawnOnMouseClick(float deltaTime);
+	sf::Vector2f mapMouseToWorld() const;
+	sf::Vector2f mouseInMeters() const;
+	void refreshGrid();
+	void grab();
+	void holdGrabbed(float deltaTime);
+	void release(float deltaTime);
+	void blast(sf::Vector2f center);
+	void drawHover();
+	void cycleRenderScale();
+	void showNotice(const std::string& text, sf::Color color);
+	void resizeRenderTargets();
+	void reportStartup();
+	void applyConfig(const Config::Values& previous);
+	bool isAtCircleLimit() const;
+	void warmUpGlyphs(int count);
 };
\ No newline at end of file
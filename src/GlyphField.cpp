@@ -0,0 +1,224 @@
+#include "GlyphField.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace
+{
+	// Field resolution and the margin around the ink, in pixels. The margin
+	// covers the largest circle so distances near the text are exact.
+	const int CELL_PIXELS = 2;
+	const int PAD_CELLS = 8;
+	const float FAR = 1e20f;
+
+	typedef std::tuple<const sf::Font*, unsigned int, std::basic_string<sf::Uint32>> FieldKey;
+
+	// Fonts belong to a world, so does the cache
+	std::map<FieldKey, std::shared_ptr<const GlyphField>>& cache()
+	{
+		thread_local std::map<FieldKey, std::shared_ptr<const GlyphField>> fields;
+		return fields;
+	}
+
+	// Squared distance transform of one row or column (Felzenszwalb & Huttenlocher)
+	void transformLine(const float* f, int n, float* d, int* v, float* z)
+	{
+		int k = 0;
+		v[0] = 0;
+		z[0] = -FAR;
+		z[1] = FAR;
+		for (int q = 1; q < n; q++)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			while (s <= z[k])
+			{
+				k--;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = FAR;
+		}
+		k = 0;
+		for (int q = 0; q < n; q++)
+		{
+			while (z[k + 1] < q)
+			{
+				k++;
+			}
+			d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+		}
+	}
+}
+
+GlyphField::GlyphField() :
+	_width(0),
+	_height(0)
+{
+}
+
+std::shared_ptr<const GlyphField> GlyphField::get(const sf::Font& font, const sf::String& text, unsigned int characterSize)
+{
+	FieldKey key(&font, characterSize, text.toUtf32());
+	auto found = cache().find(key);
+	if (found != cache().end())
+	{
+		return found->second;
+	}
+	std::shared_ptr<GlyphField> field = std::make_shared<GlyphField>();
+	field->build(font, text, characterSize);
+	cache()[key] = field;
+	return field;
+}
+
+bool GlyphField::isEmpty() const
+{
+	return _distance.empty();
+}
+
+void GlyphField::build(const sf::Font& font, const sf::String& text, unsigned int characterSize)
+{
+	// Same layout as sf::Text: baseline one character size down, advance plus kerning
+	struct Quad
+	{
+		sf::Vector2i position;
+		sf::IntRect source;
+	};
+	std::vector<Quad> quads;
+	float x = 0.0f;
+	float baseline = static_cast<float>(characterSize);
+	sf::Uint32 previous = 0;
+	int minX = 0;
+	int minY = 0;
+	int maxX = 0;
+	int maxY = 0;
+	for (std::size_t i = 0; i < text.getSize(); i++)
+	{
+		sf::Uint32 c = text[i];
+		x += font.getKerning(previous, c, characterSize);
+		previous = c;
+		const sf::Glyph& glyph = font.getGlyph(c, characterSize, false);
+		if (glyph.textureRect.width > 0 && glyph.textureRect.height > 0)
+		{
+			Quad quad;
+			quad.position = sf::Vector2i(static_cast<int>(std::floor(x + glyph.bounds.left)), static_cast<int>(std::floor(baseline + glyph.bounds.top)));
+			quad.source = glyph.textureRect;
+			if (quads.empty())
+			{
+				minX = quad.position.x;
+				minY = quad.position.y;
+				maxX = minX;
+				maxY = minY;
+			}
+			minX = std::min(minX, quad.position.x);
+			minY = std::min(minY, quad.position.y);
+			maxX = std::max(maxX, quad.position.x + quad.source.width);
+			maxY = std::max(maxY, quad.position.y + quad.source.height);
+			quads.push_back(quad);
+		}
+		x += glyph.advance;
+	}
+	if (quads.empty())
+	{
+		return;
+	}
+
+	// Average atlas coverage per cell, read back once per field
+	_origin = sf::Vector2f(static_cast<float>(minX - PAD_CELLS * CELL_PIXELS), static_cast<float>(minY - PAD_CELLS * CELL_PIXELS));
+	_width = (maxX - minX + CELL_PIXELS - 1) / CELL_PIXELS + 2 * PAD_CELLS;
+	_height = (maxY - minY + CELL_PIXELS - 1) / CELL_PIXELS + 2 * PAD_CELLS;
+	std::vector<float> coverage(_width * _height, 0.0f);
+	sf::Image atlas = font.getTexture(characterSize).copyToImage();
+	const float weight = 1.0f / (255.0f * CELL_PIXELS * CELL_PIXELS);
+	for (const Quad& quad : quads)
+	{
+		for (int py = 0; py < quad.source.height; py++)
+		{
+			int cy = (quad.position.y + py - static_cast<int>(_origin.y)) / CELL_PIXELS;
+			for (int px = 0; px < quad.source.width; px++)
+			{
+				int cx = (quad.position.x + px - static_cast<int>(_origin.x)) / CELL_PIXELS;
+				coverage[cy * _width + cx] += atlas.getPixel(quad.source.left + px, quad.source.top + py).a * weight;
+			}
+		}
+	}
+
+	std::vector<float> toInk(_width * _height);
+	std::vector<float> toSpace(_width * _height);
+	for (std::size_t i = 0; i < coverage.size(); i++)
+	{
+		bool inside = coverage[i] >= 0.5f;
+		toInk[i] = inside ? 0.0f : FAR;
+		toSpace[i] = inside ? FAR : 0.0f;
+	}
+	distanceTransform(toInk, _width, _height);
+	distanceTransform(toSpace, _width, _height);
+
+	// Cell centres are half a cell from the edge between ink and space
+	_distance.resize(_width * _height);
+	for (std::size_t i = 0; i < coverage.size(); i++)
+	{
+		float cells = coverage[i] >= 0.5f ? -(std::sqrt(toSpace[i]) - 0.5f) : std::sqrt(toInk[i]) - 0.5f;
+		_distance[i] = cells * CELL_PIXELS;
+	}
+}
+
+void GlyphField::distanceTransform(std::vector<float>& grid, int width, int height)
+{
+	int size = std::max(width, height);
+	std::vector<float> f(size);
+	std::vector<float> d(size);
+	std::vector<int> v(size);
+	std::vector<float> z(size + 1);
+	for (int y = 0; y < height; y++)
+	{
+		transformLine(&grid[y * width], width, d.data(), v.data(), z.data());
+		std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+	}
+	for (int x = 0; x < width; x++)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			f[y] = grid[y * width + x];
+		}
+		transformLine(f.data(), height, d.data(), v.data(), z.data());
+		for (int y = 0; y < height; y++)
+		{
+			grid[y * width + x] = d[y];
+		}
+	}
+}
+
+float GlyphField::sample(sf::Vector2f point, sf::Vector2f& normal) const
+{
+	// Bilinear between cell centres, the gradient of the same four samples is the normal
+	float gx = (point.x - _origin.x) / CELL_PIXELS - 0.5f;
+	float gy = (point.y - _origin.y) / CELL_PIXELS - 0.5f;
+	float cx = std::clamp(gx, 0.0f, static_cast<float>(_width - 1));
+	float cy = std::clamp(gy, 0.0f, static_cast<float>(_height - 1));
+	int x0 = std::min(static_cast<int>(cx), _width - 2);
+	int y0 = std::min(static_cast<int>(cy), _height - 2);
+	float fx = cx - x0;
+	float fy = cy - y0;
+	float d00 = _distance[y0 * _width + x0];
+	float d10 = _distance[y0 * _width + x0 + 1];
+	float d01 = _distance[(y0 + 1) * _width + x0];
+	float d11 = _distance[(y0 + 1) * _width + x0 + 1];
+	float distance = (d00 * (1.0f - fx) + d10 * fx) * (1.0f - fy) + (d01 * (1.0f - fx) + d11 * fx) * fy;
+
+	// Beyond the margin everything is outside, add the way to the field's edge
+	sf::Vector2f beyond((gx - cx) * CELL_PIXELS, (gy - cy) * CELL_PIXELS);
+	float beyondLength = std::sqrt(beyond.x * beyond.x + beyond.y * beyond.y);
+	if (beyondLength > 0.0f)
+	{
+		normal = beyond / beyondLength;
+		return distance + beyondLength;
+	}
+	sf::Vector2f gradient((d10 - d00) * (1.0f - fy) + (d11 - d01) * fy, (d01 - d00) * (1.0f - fx) + (d11 - d10) * fx);
+	float gradientLength = std::sqrt(gradient.x * gradient.x + gradient.y * gradient.y);
+	normal = gradientLength > 0.0f ? gradient / gradientLength : sf::Vector2f(0.0f, -1.0f);
+	return distance;
+}
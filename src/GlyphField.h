@@ -0,0 +1,26 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <vector>
+
+// Low resolution signed distance field of a text's glyph shapes, in the text's
+// local pixels, negative inside the ink. Built once from the font atlas the
+// text renders from: glyph coverage is laid out the way sf::Text lays it out,
+// thresholded per cell, and two distance transforms give the distance outside
+// and inside. Fields are cached per font, size and string since notices repeat.
+class GlyphField
+{
+public:
+	static std::shared_ptr<const GlyphField> get(const sf::Font& font, const sf::String& text, unsigned int characterSize);
+	// Signed distance at a local point and the outward normal there
+	float sample(sf::Vector2f point, sf::Vector2f& normal) const;
+	bool isEmpty() const;
+	GlyphField();
+private:
+	sf::Vector2f _origin;
+	int _width;
+	int _height;
+	std::vector<float> _distance;
+	void build(const sf::Font& font, const sf::String& text, unsigned int characterSize);
+	static void distanceTransform(std::vector<float>& grid, int width, int height);
+};
@@ -0,0 +1,64 @@
+#include "HSV.h"
+#include <cmath>
+
+HSV::Table::Table()
+{
+	for (int i = 0; i < TABLE_SIZE; i++)
+	{
+		float h = static_cast<float>(i) / STEPS_PER_DEGREE;
+		int hi = static_cast<int>(h / 60) % 6;
+		float f = h / 60 - std::floor(h / 60);
+		float& r = entries[i].r;
+		float& g = entries[i].g;
+		float& b = entries[i].b;
+		entries[i].pad = 0.0f;
+		switch (hi) {
+		case 0: r = 1.0f;     g = f;        b = 0.0f;     break;
+		case 1: r = 1.0f - f; g = 1.0f;     b = 0.0f;     break;
+		case 2: r = 0.0f;     g = 1.0f;     b = f;        break;
+		case 3: r = 0.0f;     g = 1.0f - f; b = 1.0f;     break;
+		case 4: r = f;        g = 0.0f;     b = 1.0f;     break;
+		default: r = 1.0f;    g = 0.0f;     b = 1.0f - f; break;
+		}
+	}
+}
+
+const HSV::Table& HSV::table()
+{
+	static const Table lut;
+	return lut;
+}
+
+int HSV::index(float h)
+{
+	int i = static_cast<int>(h * STEPS_PER_DEGREE);
+	if (static_cast<unsigned int>(i) >= TABLE_SIZE)
+	{
+		i = ((i % TABLE_SIZE) + TABLE_SIZE) % TABLE_SIZE;
+	}
+	return i;
+}
+
+sf::Color HSV::toRGB(float h, float s, float v)
+{
+	sf::Color out;
+	toRGB(&h, &s, &v, &out, 1);
+	return out;
+}
+
+void HSV::toRGB(const float* h, const float* s, const float* v, sf::Color* out, std::size_t count)
+{
+	// channel = v * (1 - s * (1 - saturatedChannel)), the textbook p/q/t terms
+	const Table& lut = table();
+	for (std::size_t n = 0; n < count; n++)
+	{
+		const Entry& e = lut.entries[index(h[n])];
+		float scale = v[n] * 255.0f;
+		float range = scale * s[n];
+		float base = scale - range;
+		out[n].r = static_cast<sf::Uint8>(static_cast<int>(base + range * e.r));
+		out[n].g = static_cast<sf::Uint8>(static_cast<int>(base + range * e.g));
+		out[n].b = static_cast<sf::Uint8>(static_cast<int>(base + range * e.b));
+		out[n].a = 255;
+	}
+}
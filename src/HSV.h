@@ -0,0 +1,30 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include <cstddef>
+
+// Shared HSV -> RGB conversion. Hue is quantised to a quarter degree and
+// looked up in a table of fully saturated colours, saturation and value are
+// then two multiply-adds per channel, so a batch converts without branches.
+class HSV
+{
+public:
+	static sf::Color toRGB(float h, float s, float v);
+	static void toRGB(const float* h, const float* s, const float* v, sf::Color* out, std::size_t count);
+private:
+	static const int STEPS_PER_DEGREE = 4;
+	static const int TABLE_SIZE = 360 * STEPS_PER_DEGREE;
+	struct Entry
+	{
+		float r;
+		float g;
+		float b;
+		float pad;
+	};
+	struct Table
+	{
+		Table();
+		Entry entries[TABLE_SIZE];
+	};
+	static const Table& table();
+	static int index(float h);
+};
@@ -0,0 +1,302 @@
+#include "InputRecorder.h"
+#include <iostream>
+
+const std::uint32_t InputRecorder::VERSION = 1;
+const std::uint8_t InputRecorder::END_OF_STREAM = 0xFF;
+
+namespace
+{
+	const char MAGIC[4] = { 'R', 'S', 'S', 'I' };
+	const std::uint8_t FRAME_MOUSE_MOVED = 1;
+	const std::uint8_t FRAME_HAS_EVENTS = 2;
+}
+
+InputRecorder::InputRecorder() :
+	_mode(Off),
+	_finished(false),
+	_seed(0),
+	_dt(0.0f),
+	_mousePosition(0, 0),
+	_frames(0),
+	_recordedHash(0)
+{
+}
+
+template <typename T> void InputRecorder::write(const T& value)
+{
+	_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T> bool InputRecorder::read(T& value)
+{
+	return static_cast<bool>(_file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool InputRecorder::startRecording(const std::string& path, std::uint32_t seed, float dt, sf::Vector2u windowSize)
+{
+	_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_file)
+	{
+		std::cout << "INPUTRECORDER: failed to create " << path << "\n";
+		return false;
+	}
+	_mode = Recording;
+	_path = path;
+	_seed = seed;
+	_dt = dt;
+	_windowSize = windowSize;
+	_file.write(MAGIC, sizeof(MAGIC));
+	write(VERSION);
+	write(_seed);
+	write(_dt);
+	write(_windowSize.x);
+	write(_windowSize.y);
+	std::cout << "INPUTRECORDER: recording to " << path << " with seed " << seed << "\n";
+	return true;
+}
+
+bool InputRecorder::startReplay(const std::string& path)
+{
+	_file.open(path, std::ios::in | std::ios::binary);
+	if (!_file)
+	{
+		std::cout << "INPUTRECORDER: failed to open " << path << "\n";
+		return false;
+	}
+	char magic[4];
+	std::uint32_t version = 0;
+	if (!_file.read(magic, sizeof(magic)) || std::string(magic, 4) != std::string(MAGIC, 4) || !read(version) || version != VERSION
+		|| !read(_seed) || !read(_dt) || !read(_windowSize.x) || !read(_windowSize.y))
+	{
+		std::cout << "INPUTRECORDER: " << path << " is not a version " << VERSION << " recording" << "\n";
+		return false;
+	}
+	_mode = Replaying;
+	_path = path;
+	std::cout << "INPUTRECORDER: replaying " << path << " with seed " << _seed << "\n";
+	return true;
+}
+
+bool InputRecorder::isRecording() const
+{
+	return _mode == Recording;
+}
+
+bool InputRecorder::isReplaying() const
+{
+	return _mode == Replaying;
+}
+
+bool InputRecorder::isFinished() const
+{
+	return _finished;
+}
+
+std::uint32_t InputRecorder::getSeed() const
+{
+	return _seed;
+}
+
+float InputRecorder::getTimestep() const
+{
+	return _dt;
+}
+
+sf::Vector2u InputRecorder::getWindowSize() const
+{
+	return _windowSize;
+}
+
+bool InputRecorder::isRecordable(const sf::Event& event)
+{
+	// Only what keyboardInput and mouseInput react to, cursor motion travels as the per-frame position
+	return event.type == sf::Event::KeyPressed
+		|| event.type == sf::Event::MouseButtonPressed
+		|| event.type == sf::Event::MouseButtonReleased
+		|| event.type == sf::Event::MouseWheelScrolled;
+}
+
+void InputRecorder::recordFrame(const std::vector<sf::Event>& events, sf::Vector2i mousePosition)
+{
+	if (_mode != Recording)
+	{
+		return;
+	}
+	std::uint8_t count = 0;
+	for (const sf::Event& event : events)
+	{
+		if (isRecordable(event) && count < END_OF_STREAM - 1)
+		{
+			count++;
+		}
+	}
+	std::uint8_t flags = 0;
+	if (mousePosition != _mousePosition)
+	{
+		flags |= FRAME_MOUSE_MOVED;
+	}
+	if (count > 0)
+	{
+		flags |= FRAME_HAS_EVENTS;
+	}
+	write(flags);
+	if (flags & FRAME_MOUSE_MOVED)
+	{
+		write(static_cast<std::int32_t>(mousePosition.x));
+		write(static_cast<std::int32_t>(mousePosition.y));
+		_mousePosition = mousePosition;
+	}
+	if (flags & FRAME_HAS_EVENTS)
+	{
+		write(count);
+		std::uint8_t written = 0;
+		for (const sf::Event& event : events)
+		{
+			if (!isRecordable(event) || written == count)
+			{
+				continue;
+			}
+			written++;
+			write(static_cast<std::uint8_t>(event.type));
+			if (event.type == sf::Event::KeyPressed)
+			{
+				std::uint8_t modifiers = (event.key.alt ? 1 : 0) | (event.key.control ? 2 : 0) | (event.key.shift ? 4 : 0) | (event.key.system ? 8 : 0);
+				write(static_cast<std::int32_t>(event.key.code));
+				write(modifiers);
+			}
+			else if (event.type == sf::Event::MouseWheelScrolled)
+			{
+				write(static_cast<std::uint8_t>(event.mouseWheelScroll.wheel));
+				write(event.mouseWheelScroll.delta);
+				write(static_cast<std::int32_t>(event.mouseWheelScroll.x));
+				write(static_cast<std::int32_t>(event.mouseWheelScroll.y));
+			}
+			else
+			{
+				write(static_cast<std::uint8_t>(event.mouseButton.button));
+				write(static_cast<std::int32_t>(event.mouseButton.x));
+				write(static_cast<std::int32_t>(event.mouseButton.y));
+			}
+		}
+	}
+	_frames++;
+}
+
+bool InputRecorder::replayFrame(std::vector<sf::Event>& events, sf::Vector2i& mousePosition)
+{
+	events.clear();
+	if (_mode != Replaying || _finished)
+	{
+		return false;
+	}
+	std::uint8_t flags = 0;
+	if (!read(flags) || flags == END_OF_STREAM)
+	{
+		if (flags == END_OF_STREAM)
+		{
+			readTrailer();
+		}
+		_finished = true;
+		return false;
+	}
+	if (flags & FRAME_MOUSE_MOVED)
+	{
+		std::int32_t x = 0;
+		std::int32_t y = 0;
+		read(x);
+		read(y);
+		_mousePosition = sf::Vector2i(x, y);
+	}
+	mousePosition = _mousePosition;
+	if (flags & FRAME_HAS_EVENTS)
+	{
+		std::uint8_t count = 0;
+		read(count);
+		for (std::uint8_t i = 0; i < count; i++)
+		{
+			std::uint8_t type = 0;
+			read(type);
+			sf::Event event;
+			event.type = static_cast<sf::Event::EventType>(type);
+			if (event.type == sf::Event::KeyPressed)
+			{
+				std::int32_t code = 0;
+				std::uint8_t modifiers = 0;
+				read(code);
+				read(modifiers);
+				event.key.code = static_cast<sf::Keyboard::Key>(code);
+				event.key.alt = (modifiers & 1) != 0;
+				event.key.control = (modifiers & 2) != 0;
+				event.key.shift = (modifiers & 4) != 0;
+				event.key.system = (modifiers & 8) != 0;
+			}
+			else if (event.type == sf::Event::MouseWheelScrolled)
+			{
+				std::uint8_t wheel = 0;
+				std::int32_t x = 0;
+				std::int32_t y = 0;
+				read(wheel);
+				read(event.mouseWheelScroll.delta);
+				read(x);
+				read(y);
+				event.mouseWheelScroll.wheel = static_cast<sf::Mouse::Wheel>(wheel);
+				event.mouseWheelScroll.x = x;
+				event.mouseWheelScroll.y = y;
+			}
+			else
+			{
+				std::uint8_t button = 0;
+				std::int32_t x = 0;
+				std::int32_t y = 0;
+				read(button);
+				read(x);
+				read(y);
+				event.mouseButton.button = static_cast<sf::Mouse::Button>(button);
+				event.mouseButton.x = x;
+				event.mouseButton.y = y;
+			}
+			events.push_back(event);
+		}
+	}
+	_frames++;
+	return static_cast<bool>(_file);
+}
+
+void InputRecorder::readTrailer()
+{
+	std::uint32_t frames = 0;
+	read(frames);
+	read(_recordedHash);
+}
+
+void InputRecorder::finish(std::uint64_t stateHash)
+{
+	if (_mode == Recording)
+	{
+		write(END_OF_STREAM);
+		write(_frames);
+		write(stateHash);
+		_file.close();
+		std::cout << "INPUTRECORDER: " << _frames << " frames written to " << _path << ", state hash " << std::hex << stateHash << std::dec << "\n";
+	}
+	else if (_mode == Replaying)
+	{
+		// The game usually stops on the recorded Escape, one frame before the trailer
+		std::uint8_t flags = 0;
+		if (!_finished && read(flags) && flags == END_OF_STREAM)
+		{
+			readTrailer();
+		}
+		_finished = true;
+		_file.close();
+		if (_recordedHash == stateHash)
+		{
+			std::cout << "INPUTRECORDER: replay of " << _frames << " frames matches the recording (" << std::hex << stateHash << std::dec << ")" << "\n";
+		}
+		else
+		{
+			std::cout << "INPUTRECORDER: replay DIVERGED, recorded " << std::hex << _recordedHash << " replayed " << stateHash << std::dec << "\n";
+		}
+	}
+	_mode = Off;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Records the per-frame input the game consumes (key presses, mouse buttons,
+// wheel and cursor position) together with the RNG seed and timestep, and
+// plays it back frame by frame. Idle frames take a single byte.
+class InputRecorder
+{
+public:
+	InputRecorder();
+	bool startRecording(const std::string& path, std::uint32_t seed, float dt, sf::Vector2u windowSize);
+	bool startReplay(const std::string& path);
+	bool isRecording() const;
+	bool isReplaying() const;
+	bool isFinished() const;
+	std::uint32_t getSeed() const;
+	float getTimestep() const;
+	sf::Vector2u getWindowSize() const;
+	void recordFrame(const std::vector<sf::Event>& events, sf::Vector2i mousePosition);
+	bool replayFrame(std::vector<sf::Event>& events, sf::Vector2i& mousePosition);
+	// Closes the stream. A recording stores the final state hash, a replay compares against it
+	void finish(std::uint64_t stateHash);
+	static bool isRecordable(const sf::Event& event);
+private:
+	enum Mode
+	{
+		Off,
+		Recording,
+		Replaying
+	};
+	static const std::uint32_t VERSION;
+	static const std::uint8_t END_OF_STREAM;
+	Mode _mode;
+	bool _finished;
+	std::fstream _file;
+	std::string _path;
+	std::uint32_t _seed;
+	float _dt;
+	sf::Vector2u _windowSize;
+	sf::Vector2i _mousePosition;
+	std::uint32_t _frames;
+	std::uint64_t _recordedHash;
+	template <typename T> void write(const T& value);
+	template <typename T> bool read(T& value);
+	void readTrailer();
+};
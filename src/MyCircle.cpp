@@ -1,15 +1,25 @@
 #include "MyCircle.h"
 #include "GameManager.h"
-static float SEQ_HUE = 0.0f;
+#include "HSV.h"
+#include "Random.h"
+#include "Config.h"
+#include "World.h"
+
+// Point counts a circle can be tessellated with. The largest allowed distance
+// in pixels between the polygon edge and the true circle is render.lodMaxError.
+static const std::size_t LOD_LEVELS[] = { 6, 8, 12, 16, 20, 24, 32, 48 };
 MyCircle::MyCircle():
+	_acceleration(),
+	_velocity(),
 	_hue(0.0f),
 	_saturation(1.0f),
 	_value(0.0f),
-	_acceleration(),
-	_velocity()
+	_lodPixelsPerUnit(0.0f),
+	_lodMaxError(0.0f),
+	_lodPoints(20)
 {	
-	this->_hue = SEQ_HUE;
-	SEQ_HUE = SEQ_HUE + 0.01f;
+	this->_hue = World::current().circleHue;
+	World::current().circleHue += 0.01f;
 	float rad = this->getRandomRad();
 	_circle = std::make_unique<sf::CircleShape>(rad);
 	_circle->setOrigin(_circle->getRadius(), _circle->getRadius());
@@ -17,18 +27,20 @@ MyCircle::MyCircle():
 	sf::Vector2f curPos(this->getRandomPos());
 	this->setPositionFromMetersToPixels(curPos);
 	this->initMass();
-	this->_circle->setPointCount(20);
 }
 
 MyCircle::MyCircle(sf::Vector2f& pos):
+	_acceleration(),
+	_velocity(),
 	_hue(0.0f),
 	_saturation(1.0f),
 	_value(0.0f),
-	_acceleration(),
-	_velocity()
+	_lodPixelsPerUnit(0.0f),
+	_lodMaxError(0.0f),
+	_lodPoints(20)
 {	
-	this->_hue = SEQ_HUE;
-	SEQ_HUE = SEQ_HUE + 0.01f;
+	this->_hue = World::current().circleHue;
+	World::current().circleHue += 0.01f;
 	float rad = this->getRandomRad();
 	_circle = std::make_unique<sf::CircleShape>(rad);
 	_circle->setOrigin(_circle->getRadius(), _circle->getRadius());
@@ -36,7 +48,6 @@ MyCircle::MyCircle(sf::Vector2f& pos):
 	sf::Vector2f curPos(pos / Settings::getConversionFactor());
 	this->setPositionFromMetersToPixels(curPos);
 	this->initMass();
-	this->_circle->setPointCount(20);
 	//this->randomizeVelocity();
 	//std::cout << "Mouse METERS X= " << (float)this->getPositionInMetersFromPixels()->x << " Mouse METERS Y= " << (float)this->getPositionInMetersFromPixels()->y << " Mouse PIXELS X= " << (float)this->_circle->getPosition().x << " Mouse PIXELS Y= " << (float)this->_circle->getPosition().y << "\n";
 }
@@ -98,8 +109,7 @@ void MyCircle::updateColor(float deltaTime)
 	{
 		this->_value = 0.9f;
 	}
-	sf::Color newColor = HSVtoRGB(this->_hue, this->_saturation, this->_value);
-	_circle->setFillColor(newColor);
+	// Converted to RGB for all circles at once when the frame is batched
 }
 
 bool MyCircle::isIntersect(const MyCircle& c2) const
@@ -168,23 +178,65 @@ bool MyCircle::contains(sf::Vector2f& p) const
 	}
 	return false;
 }
-sf::Color MyCircle::HSVtoRGB(float h, float s, float v)
+bool MyCircle::isVisible(const sf::FloatRect& viewRect) const
+{
+	const sf::Vector2f& pos = _circle->getPosition();
+	float r = _circle->getRadius();
+	return pos.x + r >= viewRect.left && pos.x - r <= viewRect.left + viewRect.width
+		&& pos.y + r >= viewRect.top && pos.y - r <= viewRect.top + viewRect.height;
+}
+
+void MyCircle::updateLod(float pixelsPerUnit)
 {
-	int hi = static_cast<int>(h / 60) % 6;
-	float f = h / 60 - std::floor(h / 60);
-	float p = v * (1 - s);
-	float q = v * (1 - f * s);
-	float t = v * (1 - (1 - f) * s);
-	switch (hi) {
-	case 0: return sf::Color(static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(t * 255), static_cast<sf::Uint8>(p * 255));
-	case 1: return sf::Color(static_cast<sf::Uint8>(q * 255), static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(p * 255));
-	case 2: return sf::Color(static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(t * 255));
-	case 3: return sf::Color(static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(q * 255), static_cast<sf::Uint8>(v * 255));
-	case 4: return sf::Color(static_cast<sf::Uint8>(t * 255), static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(v * 255));
-	default: return sf::Color(static_cast<sf::Uint8>(v * 255), static_cast<sf::Uint8>(p * 255), static_cast<sf::Uint8>(q * 255));
+	// Only recompute when the zoom, render scale or allowed error changed
+	float maxError = Config::get().lodMaxError;
+	if (pixelsPerUnit == _lodPixelsPerUnit && maxError == _lodMaxError)
+	{
+		return;
+	}
+	_lodPixelsPerUnit = pixelsPerUnit;
+	_lodMaxError = maxError;
+
+	// A regular n-gon deviates from its circle by r * (1 - cos(pi / n))
+	float screenRadius = _circle->getRadius() * pixelsPerUnit;
+	float needed = static_cast<float>(LOD_LEVELS[0]);
+	if (screenRadius > maxError)
+	{
+		needed = 3.14159265f / std::acos(1.0f - maxError / screenRadius);
+	}
+	std::size_t points = LOD_LEVELS[std::size(LOD_LEVELS) - 1];
+	for (std::size_t level : LOD_LEVELS)
+	{
+		if (static_cast<float>(level) >= needed)
+		{
+			points = level;
+			break;
+		}
 	}
+	_lodPoints = points;
 }
 
+std::size_t MyCircle::getLodPointCount() const
+{
+	return _lodPoints;
+}
+
+float MyCircle::getHue() const
+{
+	return _hue;
+}
+
+float MyCircle::getSaturation() const
+{
+	return _saturation;
+}
+
+float MyCircle::getValue() const
+{
+	return _value;
+}
+
+
 void MyCircle::initMass()
 {
 	// Mass/size ratio
@@ -201,9 +253,9 @@ void MyCircle::resetAcceleration()
 
 sf::Vector2f MyCircle::getRandomPos() const
 {
-	// Get the dimensions of the screen in pixels
-	float screenWidthPixels = static_cast<float>(sf::VideoMode::getDesktopMode().width);
-	float screenHeightPixels = static_cast<float>(sf::VideoMode::getDesktopMode().height);
+	// Get the dimensions of the world's display in pixels
+	float screenWidthPixels = static_cast<float>(World::current().getSize().x);
+	float screenHeightPixels = static_cast<float>(World::current().getSize().y);
 
 	// Calculate the valid range for random X and Y positions in pixels
 	float minX = getRadiusInMetersFromPixels();
@@ -212,43 +264,30 @@ sf::Vector2f MyCircle::getRandomPos() const
 	float maxY = screenHeightPixels - getRadiusInMetersFromPixels();
 
 	// Generate random X and Y positions in pixels within the valid range
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<float> xDis(minX, maxX);
-	std::uniform_real_distribution<float> yDis(minY, maxY);
+	float x = Random::uniform(minX, maxX);
+	float y = Random::uniform(minY, maxY);
 
 	// Create and return the random position vector in meters
 	sf::Vector2f randomPosition(
-		xDis(gen) / Settings::getConversionFactor(),
-		yDis(gen) / Settings::getConversionFactor()
+		x / Settings::getConversionFactor(),
+		y / Settings::getConversionFactor()
 	);
 	return randomPosition;
 }
 float MyCircle::getRandomRad() 
 {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<float> dis(0.3f * Settings::getConversionFactor(), 0.7f * Settings::getConversionFactor());
-	float randRad = dis(gen);
+	float randRad = Random::uniform(0.3f * Settings::getConversionFactor(), 0.7f * Settings::getConversionFactor());
 	return randRad;
 }
 void MyCircle::randomizeColor()
 {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<int> dis(0, 360);
-	//this->_hue = dis(gen);
+	//this->_hue = Random::uniformInt(0, 360);
 	this->_value = 0.03f;
-	sf::Color randCol = HSVtoRGB(this->_hue, this->_saturation, this->_value);
-	_circle->setFillColor(randCol);
 }
 void MyCircle::randomizeVelocity()
 {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<float> dis(-1000.0f / Settings::getConversionFactor(), 1000.0f / Settings::getConversionFactor());
-	float velX = dis(gen);
-	float velY = dis(gen);
+	float velX = Random::uniform(-1000.0f / Settings::getConversionFactor(), 1000.0f / Settings::getConversionFactor());
+	float velY = Random::uniform(-1000.0f / Settings::getConversionFactor(), 1000.0f / Settings::getConversionFactor());
 	sf::Vector2f newPos(velX , velY);
 	this->accelerate(newPos);
 }
@@ -29,6 +29,12 @@ public:
 	void randomizeColor();
 	void randomizeVelocity();
 	bool contains(sf::Vector2f &p) const;
+	bool isVisible(const sf::FloatRect& viewRect) const;
+	void updateLod(float pixelsPerUnit);
+	std::size_t getLodPointCount() const;
+	float getHue() const;
+	float getSaturation() const;
+	float getValue() const;
 	bool isIntersect(const MyCircle& c2) const;
 	float getMass();
 	void move(sf::Vector2f vec);
@@ -39,9 +45,11 @@ private:
 	float _saturation;
 	float _value;
 	float _mass;
+	float _lodPixelsPerUnit;
+	float _lodMaxError;
+	std::size_t _lodPoints;
 	sf::Vector2f getRandomPos() const;
 	static float getRandomRad();
-	sf::Color HSVtoRGB(float hue, float saturation, float value);
 	void initMass();
 	
 	
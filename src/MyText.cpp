@@ -1,112 +1,122 @@
 #include "MyText.h"
+#include "AllocTracker.h"
 #include "GameManager.h"
-bool MyText::BLOCKSPAWN = false;
+#include "HSV.h"
 float MyText::FADEINSPEED = 1.0f;
 float MyText::FADEOUTSPEED = 1.0f;
-int MyText::COUNT = 0;
-float MyText::SEQ_HUE = getRandomHue();
-std::deque<MyText*>MyText::_fadeInQ;
-std::deque<MyText*>MyText::_fadeOutQ;
 
 MyText::MyText(const std::string& text, float x, float y, sf::Font& font, std::vector<std::shared_ptr<MyText>>& texts) :
+	_world(&World::current()),
+	_instantFade(false),
 	_flashActive(false),
-	_texts(&texts),
+	_collision(true),
 	_rdyForRemove(false),
+	_id(_world->textCount),
+	_texts(&texts),
 	_colorTransition(true),
-	_alpha(0),	
-	_hue(SEQ_HUE),
+	_alpha(0),
+	_batchId(-1),
+	_hue(_world->textHue),
 	_saturation(0.6f),
-	_value(0.0f),
-	_id(COUNT),
-	_collision(false),
-	_instantFade(false)
+	_value(0.0f)
 {
 	_text = std::make_shared<sf::Text>();
-	COUNT++;
+	_world->textCount++;
 	sf::Vector2f position(x * Settings::getConversionFactor(), y * Settings::getConversionFactor());
 	_text->setFont(font);
 	_text->setString(text);
-	sf::Color hsv(HSVtoRGB(this->_hue, this->_saturation, this->_value));
+	sf::Color hsv(HSV::toRGB(this->_hue, this->_saturation, this->_value));
 	_text->setFillColor(hsv);
+	_color = hsv;
 	_text->setCharacterSize(30);
 	float width = _text->getLocalBounds().width;
 	float height = _text->getLocalBounds().height;
 	_text->setOrigin(width / 2, height / 2);
 	_text->setPosition(position);
+	// The intro lines are solid, the first circles land on their glyphs
+	_field = GlyphField::get(font, _text->getString(), _text->getCharacterSize());
 	this->cycleColorOnConstruct();
 	this->fadeIn();
 }
 
 MyText::MyText(const std::string& text, float x, float y, sf::Font& font, std::vector<std::shared_ptr<MyText>>& texts, sf::Color color) :
+	_world(&World::current()),
+	_instantFade(false),
 	_flashActive(false),
-	_texts(&texts),
+	_collision(true),
 	_rdyForRemove(false),
+	_id(_world->textCount),
+	_texts(&texts),
 	_colorTransition(false),
-	_alpha(0),	
+	_alpha(0),
+	_batchId(-1),
 	_hue(0.0f),
 	_saturation(1.0f),
-	_value(0.0f),
-	_id(COUNT),
-	_collision(true),
-	_instantFade(false)
+	_value(0.0f)
 {
 	_text = std::make_shared<sf::Text>();
-	COUNT++;
+	_world->textCount++;
 	sf::Vector2f position(x * Settings::getConversionFactor(), y * Settings::getConversionFactor());
 	_text->setString(text);
 	_text->setFont(font);
 	sf::Color hsvColor = RGBtoHSV(color);
 	_hue = hsvColor.r;
 	_saturation = hsvColor.g;
-	sf::Color hsv(HSVtoRGB(this->_hue, this->_saturation, this->_value));
+	sf::Color hsv(HSV::toRGB(this->_hue, this->_saturation, this->_value));
 	_text->setFillColor(hsv);
+	_color = hsv;
 	_text->setCharacterSize(35);
 	float width = _text->getLocalBounds().width;
 	float height = _text->getLocalBounds().height;
 	_text->setOrigin(width / 2, height / 2);
 	_text->setPosition(position);
+	// Circles bounce off this one, rasterise the glyph shapes for them once
+	_field = GlyphField::get(font, _text->getString(), _text->getCharacterSize());
 	this->fadeIn();
 }
 MyText::MyText(const std::string& text, float x, float y, sf::Font& font, std::vector<std::shared_ptr<MyText>>& texts, sf::Color color, bool instantFade) :
+	_world(&World::current()),
+	_instantFade(true),
 	_flashActive(false),
-	_texts(&texts),
+	_collision(false),
 	_rdyForRemove(false),
+	_id(_world->textCount),
+	_texts(&texts),
 	_colorTransition(false),
 	_alpha(0),
-	_hue(SEQ_HUE),
+	_batchId(-1),
+	_hue(_world->textHue),
 	_saturation(1.0f),
-	_value(0.0f),
-	_id(COUNT),
-	_collision(false),
-	_instantFade(true)
+	_value(0.0f)
 {
-	if (BLOCKSPAWN) 
+	if (_world->blockTextSpawn) 
 	{
-		for (auto& text : _fadeInQ) 
+		for (auto& text : _world->fadeInQueue) 
 		{
 			text->fadeOut();
-			if (text->_id == _fadeInQ.back()->_id) 
+			if (text->_id == _world->fadeInQueue.back()->_id) 
 			{
-				_fadeInQ.pop_back();
+				_world->fadeInQueue.pop_back();
 			}
 		}
 	}
 	_text = std::make_shared<sf::Text>();
-	COUNT++;
+	_world->textCount++;
 	sf::Vector2f position(x * Settings::getConversionFactor(), y * Settings::getConversionFactor());
 	this->_text->setFont(font);
 	this->_text->setString(text);
 	this->_text->setFillColor(color);
 	sf::Color rgb(RGBtoHSV(this->_text->getFillColor()));
 	this->_hue = rgb.r;
-	sf::Color hsv(HSVtoRGB(this->_hue, this->_saturation, this->_value));
+	sf::Color hsv(HSV::toRGB(this->_hue, this->_saturation, this->_value));
 	_text->setFillColor(hsv);
+	_color = hsv;
 	_text->setCharacterSize(30);
 	float width = _text->getLocalBounds().width;
 	float height = _text->getLocalBounds().height;
 	_text->setOrigin(width / 2, height / 2);
 	_text->setPosition(position);
-	BLOCKSPAWN = true;
+	_world->blockTextSpawn = true;
 	this->fadeIn();
 }
 
@@ -126,12 +136,14 @@ void MyText::updateText(float deltaTime)
 
 void MyText::fadeIn()
 {
-	_fadeInQ.push_front(this);
+	_world->fadeInQueue.push_front(this);
 }
 
 void MyText::fadeOut()
 {
-	_fadeOutQ.push_front(this);
+	// Retiring a notice, the queue's blocks are part of its lifetime
+	ALLOC_EXEMPT();
+	_world->fadeOutQueue.push_front(this);
 }
 
 
@@ -163,43 +175,35 @@ bool MyText::fadingOut(float deltaTime)
 		return false;
 	}
 }
-float MyText::getRandomHue() 
-{
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<int> dis(0, 360);
-	float hue = dis(gen);
-	return hue;
-}
 void MyText::cycleColorOnConstruct()
 {
-	SEQ_HUE = SEQ_HUE - 50.0f;
+	_world->textHue = _world->textHue - 50.0f;
 }
 void MyText::updateNoColor(float deltaTime)
 {
-	if (!_fadeInQ.empty())
+	if (!_world->fadeInQueue.empty())
 	{
-		if (this->_id == _fadeInQ.back()->_id)
+		if (this->_id == _world->fadeInQueue.back()->_id)
 		{
 			if (!this->fadingIn(deltaTime))
 			{
-				_fadeInQ.pop_back();
+				_world->fadeInQueue.pop_back();
 				if (this->_instantFade)
 				{
 					this->fadeOut();
-					BLOCKSPAWN = false;
+					_world->blockTextSpawn = false;
 				}
 			}
 		}
 	}
-	if (!_fadeOutQ.empty())
+	if (!_world->fadeOutQueue.empty())
 	{
-		if (this->_id == _fadeOutQ.back()->_id)
+		if (this->_id == _world->fadeOutQueue.back()->_id)
 		{
 			this->_collision = false;
 			if (!this->fadingOut(deltaTime))
 			{
-				_fadeOutQ.pop_back();
+				_world->fadeOutQueue.pop_back();
 				this->_rdyForRemove = true;
 			}
 		}
@@ -219,8 +223,8 @@ void MyText::updateNoColor(float deltaTime)
 	//Normalize the color before setting
 	normalize();
 
-	sf::Color hsv(HSVtoRGB(this->_hue, this->_saturation, this->_value));
-	_text->setFillColor(hsv);
+	// Only the batch colour changes, the glyph geometry is left alone
+	_color = HSV::toRGB(this->_hue, this->_saturation, this->_value);
 }
 void MyText::updateColor(float deltaTime)
 {
@@ -232,34 +236,12 @@ void MyText::updateColor(float deltaTime)
 
 		//Normalize the color before setting
 		normalize();
-		sf::Color hsv(HSVtoRGB(this->_hue, this->_saturation, this->_value));
-		_text->setFillColor(hsv);
+		_color = HSV::toRGB(this->_hue, this->_saturation, this->_value);
 }
 bool MyText::isSafeToRemove()
 {
 	return this->_rdyForRemove;
 }
-sf::Color MyText::HSVtoRGB(float h, float s, float v) const
-{
-	int hi = static_cast<int>(h / 60) % 6;
-	float f = h / 60 - std::floor(h / 60);
-	float p = v * (1 - s);
-	float q = v * (1 - f * s);
-	float t = v * (1 - (1 - f) * s);
-
-	sf::Uint8 r, g, b;
-
-	switch (hi) {
-	case 0: r = static_cast<sf::Uint8>(v * 255); g = static_cast<sf::Uint8>(t * 255); b = static_cast<sf::Uint8>(p * 255); break;
-	case 1: r = static_cast<sf::Uint8>(q * 255); g = static_cast<sf::Uint8>(v * 255); b = static_cast<sf::Uint8>(p * 255); break;
-	case 2: r = static_cast<sf::Uint8>(p * 255); g = static_cast<sf::Uint8>(v * 255); b = static_cast<sf::Uint8>(t * 255); break;
-	case 3: r = static_cast<sf::Uint8>(p * 255); g = static_cast<sf::Uint8>(q * 255); b = static_cast<sf::Uint8>(v * 255); break;
-	case 4: r = static_cast<sf::Uint8>(t * 255); g = static_cast<sf::Uint8>(p * 255); b = static_cast<sf::Uint8>(v * 255); break;
-	default: r = static_cast<sf::Uint8>(v * 255); g = static_cast<sf::Uint8>(p * 255); b = static_cast<sf::Uint8>(q * 255); break;
-	}
-
-	return sf::Color(r, g, b);
-}
 sf::Color MyText::RGBtoHSV(const sf::Color& rgbColor) const 
 {
     float r = (float)rgbColor.r / 255.0f;
@@ -308,11 +290,21 @@ bool MyText::getCollisionsState() const
 	return this->_collision;
 }
 bool MyText::isIntersect(std::shared_ptr<MyCircle> circle) const {
+	sf::Vector2f normal;
+	float penetration;
+	return getContact(*circle, normal, penetration);
+}
+bool MyText::getContact(const MyCircle& circle, sf::Vector2f& normal, float& penetration) const
+{
+	if (!_field || _field->isEmpty())
+	{
+		return false;
+	}
 	sf::Vector2f textPosition = _text->getPosition() / Settings::getConversionFactor();
 	sf::Vector2f textSize = sf::Vector2f(_text->getGlobalBounds().width / Settings::getConversionFactor(), _text->getGlobalBounds().height / Settings::getConversionFactor());
 
-	sf::Vector2f circlePosition = circle->getPositionInMetersFromPixels();
-	float circleRadius = circle->getRadiusInMetersFromPixels();
+	sf::Vector2f circlePosition = circle.getPositionInMetersFromPixels();
+	float circleRadius = circle.getRadiusInMetersFromPixels();
 
 	// Calculate the corners of the text's bounding box
 	sf::Vector2f textTopLeft = textPosition - textSize * 0.5f;
@@ -326,8 +318,16 @@ bool MyText::isIntersect(std::shared_ptr<MyCircle> circle) const {
 	float distanceSquared = (circlePosition.x - closestX) * (circlePosition.x - closestX) +
 		(circlePosition.y - closestY) * (circlePosition.y - closestY);
 
-	// Intersection occurs if the distance is less than or equal to the circle radius squared
-	return distanceSquared <= (circleRadius * circleRadius);
+	// Outside the box is a cheap miss, inside it the glyph field decides
+	if (distanceSquared > (circleRadius * circleRadius))
+	{
+		return false;
+	}
+	// The field is in the text's local pixels, texts are only ever moved, never scaled
+	sf::Vector2f local = _text->getInverseTransform().transformPoint(circle._circle->getPosition());
+	float distance = _field->sample(local, normal);
+	penetration = (circle._circle->getRadius() - distance) / Settings::getConversionFactor();
+	return penetration > 0.0f;
 }
 void MyText::setColor(sf::Color color)
 {
@@ -336,6 +336,18 @@ void MyText::setColor(sf::Color color)
 	this->_saturation = newCol.g;
 	this->_value = newCol.b;
 }
+const sf::Color& MyText::getColor() const
+{
+	return this->_color;
+}
+int MyText::getBatchId() const
+{
+	return this->_batchId;
+}
+void MyText::setBatchId(int id)
+{
+	this->_batchId = id;
+}
 void MyText::quickFlash()
 {
 	this->_value = 0.15f;	
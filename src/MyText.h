@@ -1,6 +1,8 @@
 #pragma once
 #include "SFML/Graphics.hpp"
 #include "MyCircle.h"
+#include "World.h"
+#include "GlyphField.h"
 #include <random>
 #include <iostream>
 #include <queue>
@@ -18,26 +20,31 @@ public:
 	bool isSafeToRemove();
 	bool getCollisionsState() const;
 	bool isIntersect(std::shared_ptr<MyCircle> circle) const;
+	// Outward normal and depth in meters where a circle overlaps the glyphs,
+	// the bounding box rejects most circles before the field is sampled
+	bool getContact(const MyCircle& circle, sf::Vector2f& normal, float& penetration) const;
 	void setColor(sf::Color color);
+	const sf::Color& getColor() const;
+	int getBatchId() const;
+	void setBatchId(int id);
 	void quickFlash();
 	
 private:
-	static bool BLOCKSPAWN;
 	static float FADEINSPEED;
 	static float FADEOUTSPEED;
-	static int COUNT;
-	static float SEQ_HUE;
-	static float getRandomHue();
+	// Fade queues, ids and the hue sequence are per world
+	World* _world;
 	bool _instantFade;
 	bool _flashActive;
 	bool _collision;
 	bool _rdyForRemove;
-	static std::deque<MyText*> _fadeInQ;
-	static std::deque<MyText*> _fadeOutQ;
 	int _id;
+	std::shared_ptr<const GlyphField> _field;
 	std::vector<std::shared_ptr<MyText>>* _texts;
 	bool _colorTransition;
 	int _alpha;
+	sf::Color _color;
+	int _batchId;
 	float _hue;
 	float _saturation;
 	float _value;
@@ -47,6 +54,5 @@ private:
 	void cycleColorOnConstruct();
 	void updateColor(float deltaTime);
 	void updateNoColor(float deltaTime);
-	sf::Color HSVtoRGB(float h, float s, float v) const;
 	sf::Color RGBtoHSV(const sf::Color& rgbColor) const;
 };
@@ -0,0 +1,107 @@
+#include "NeighbourList.h"
+
+NeighbourList::NeighbourList() :
+	_skin(-1.0f),
+	_start(1, 0),
+	_rebuilds(0),
+	_steps(0)
+{
+}
+
+bool NeighbourList::needsRebuild(const std::vector<std::shared_ptr<MyCircle>>& circles, float skin) const
+{
+	if (skin != _skin || circles.size() != _owners.size())
+	{
+		return true;
+	}
+	// Two circles each within skin / 2 of their build position close at most skin
+	float limit = 0.25f * skin * skin;
+	for (size_t i = 0; i < circles.size(); i++)
+	{
+		if (circles[i].get() != _owners[i])
+		{
+			return true;
+		}
+		sf::Vector2f moved = circles[i]->getPositionInMetersFromPixels() - _reference[i];
+		if (moved.x * moved.x + moved.y * moved.y > limit)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void NeighbourList::build(const std::vector<std::shared_ptr<MyCircle>>& circles, const SpatialGrid& grid, float skin)
+{
+	int count = static_cast<int>(circles.size());
+	_skin = skin;
+	_owners.resize(count);
+	_reference.resize(count);
+	_radii.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		_owners[i] = circles[i].get();
+		_reference[i] = circles[i]->getPositionInMetersFromPixels();
+		_radii[i] = circles[i]->getRadiusInMetersFromPixels();
+	}
+
+	_pairs.clear();
+	auto keep = [&](int i, int j) {
+		sf::Vector2f d = _reference[j] - _reference[i];
+		float reach = _radii[i] + _radii[j] + skin;
+		if (d.x * d.x + d.y * d.y < reach * reach)
+		{
+			_pairs.emplace_back(i, j);
+		}
+	};
+	grid.forEachCandidatePair(keep);
+
+	// Counting sort by the lower index, one contiguous list per circle
+	_start.assign(count + 1, 0);
+	for (const auto& pair : _pairs)
+	{
+		_start[pair.first + 1]++;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		_start[i + 1] += _start[i];
+	}
+	_neighbours.resize(_pairs.size());
+	_fill.assign(_start.begin(), _start.end() - 1);
+	for (const auto& pair : _pairs)
+	{
+		_neighbours[_fill[pair.first]++] = pair.second;
+	}
+}
+
+void NeighbourList::reserve(int count)
+{
+	_owners.reserve(count);
+	_reference.reserve(count);
+	_radii.reserve(count);
+	_start.reserve(count + 1);
+}
+
+int NeighbourList::getPairCount() const
+{
+	return static_cast<int>(_neighbours.size());
+}
+
+void NeighbourList::countStep(bool rebuilt)
+{
+	_steps++;
+	if (rebuilt)
+	{
+		_rebuilds++;
+	}
+}
+
+std::int64_t NeighbourList::getRebuildCount() const
+{
+	return _rebuilds;
+}
+
+std::int64_t NeighbourList::getStepCount() const
+{
+	return _steps;
+}
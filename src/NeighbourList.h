@@ -0,0 +1,54 @@
+#pragma once
+#include "MyCircle.h"
+#include "SpatialGrid.h"
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Verlet neighbour lists: every pair closer than the sum of radii plus a skin
+// distance, stored per circle and reused across steps. While no circle has
+// moved more than half the skin since the build, no pair outside the lists
+// can touch, so the broad phase only reruns when that is broken. A bigger skin
+// means fewer rebuilds but more pairs to test on every step.
+class NeighbourList
+{
+public:
+	NeighbourList();
+	// True when the circles changed or one of them moved more than skin / 2
+	bool needsRebuild(const std::vector<std::shared_ptr<MyCircle>>& circles, float skin) const;
+	// The grid must be built over the same circles with the skin as its margin
+	void build(const std::vector<std::shared_ptr<MyCircle>>& circles, const SpatialGrid& grid, float skin);
+	// Calls visit(i, j) with i < j for every listed pair, in index order
+	template <typename Visit>
+	void forEachPair(Visit& visit) const
+	{
+		int count = static_cast<int>(_start.size()) - 1;
+		for (int i = 0; i < count; i++)
+		{
+			for (int n = _start[i]; n < _start[i + 1]; n++)
+			{
+				visit(i, _neighbours[n]);
+			}
+		}
+	}
+	// Grows the per-circle arrays ahead of build, where circles are created
+	void reserve(int count);
+	int getPairCount() const;
+	// Counts steps that asked for the lists, for the rebuild rate
+	void countStep(bool rebuilt);
+	std::int64_t getRebuildCount() const;
+	std::int64_t getStepCount() const;
+private:
+	float _skin;
+	std::vector<const MyCircle*> _owners;
+	std::vector<sf::Vector2f> _reference;
+	std::vector<float> _radii;
+	std::vector<int> _start;
+	std::vector<int> _neighbours;
+	std::vector<int> _fill;
+	std::vector<std::pair<int, int>> _pairs;
+	std::int64_t _rebuilds;
+	std::int64_t _steps;
+};
@@ -1,8 +1,12 @@
 #include "PhysicsEngine.h"
 #include "GameManager.h"
 #include "MyText.h"
+#include "Profiler.h"
+#include "Config.h"
+#include "World.h"
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -11,12 +15,13 @@
 #define M_PI_2 1.57079632679489661923
 #endif
 
+// Circles per pool task when sub-steps run in parallel
+const int SUBSTEP_GRAIN = 512;
 
-sf::Vector2f PhysicsEngine::_gravityValue(0.0f, 9.81f);
-bool PhysicsEngine::_gravity = true;
-
-PhysicsEngine::PhysicsEngine()
 
+PhysicsEngine::PhysicsEngine() :
+    _gravityValue(0.0f, 9.81f),
+    _gravity(true)
 {    
     this->setDimensions(10.0f);
     //_bound = std::make_unique<sf::CircleShape>(5.0f * Settings::getConversionFactor());
@@ -26,37 +31,119 @@ PhysicsEngine::PhysicsEngine()
     //std::cout << "X= " << _bound->getPosition().x / Settings::getConversionFactor() << " Y= " << _bound->getPosition().y / Settings::getConversionFactor() << "\n";
 }
 
-void PhysicsEngine::applyPhysics(std::shared_ptr<MyCircle> circle, float deltaTime)
+void PhysicsEngine::integrate(std::vector<std::shared_ptr<MyCircle>>& circles, float deltaTime)
 {
-    const uint32_t sub_step = 2;
+    const uint32_t sub_step = static_cast<uint32_t>(Config::get().subSteps);
     float sub_dt = deltaTime / (float)sub_step;
 
-    // Updating (sub_step) times between each frame to increase stability
+    // Attraction rebuilds the tree every sub-step, bodies move between them
+    bool attraction = _gravity && Config::get().gravity == "attraction";
+
+    // The parallel solver also spreads the circles over the pool, each one only touches itself
+    bool parallel = Config::get().solver == "parallel";
+    World& world = World::current();
+    auto subStepRange = [&](int begin, int end) {
+        // Circles read the conversion factor and intro state from the current world
+        World::setCurrent(&world);
+        for (int c = begin; c < end; c++)
+        {
+            subStep(circles[c], sub_dt, attraction ? _attraction[c] : _gravityValue);
+        }
+    };
+
+    // Updating (sub_step) times between each frame to increase stability,
+    // each sub-step over all circles is one profiler zone
     for (int i = 0; i < sub_step - 1; i++)
     {
-        // Performing leapfrog integration
+        PROFILE_SCOPE("Physics::subStep");
+        if (attraction)
+        {
+            computeAttraction(circles);
+        }
+        if (parallel)
+        {
+            getPool().parallelFor(static_cast<int>(circles.size()), SUBSTEP_GRAIN, subStepRange);
+        }
+        else
+        {
+            subStepRange(0, static_cast<int>(circles.size()));
+        }
+    }
+}
+void PhysicsEngine::integrate(std::shared_ptr<MyCircle>& circle, float deltaTime)
+{
+    const uint32_t sub_step = static_cast<uint32_t>(Config::get().subSteps);
+    float sub_dt = deltaTime / (float)sub_step;
 
-            // Current position + velocity
-            updatePosition(circle, sub_dt);
+    for (int i = 0; i < sub_step - 1; i++)
+    {
+        subStep(circle, sub_dt, _gravityValue);
+    }
+}
+ThreadPool& PhysicsEngine::getPool()
+{
+    int threads = ThreadPool::resolveThreadCount(Config::get().threads);
+    if (!_pool || _pool->getThreadCount() != threads)
+    {
+        _pool = std::make_unique<ThreadPool>(threads);
+    }
+    return *_pool;
+}
+void PhysicsEngine::computeAttraction(const std::vector<std::shared_ptr<MyCircle>>& circles)
+{
+    const Config::Values& config = Config::get();
+    ThreadPool& pool = getPool();
+    _bodyPositions.resize(circles.size());
+    _bodyMasses.resize(circles.size());
+    for (size_t c = 0; c < circles.size(); c++)
+    {
+        _bodyPositions[c] = circles[c]->getPositionInMetersFromPixels();
+        _bodyMasses[c] = circles[c]->getMass();
+    }
+    _tree.setParameters(config.theta, config.softening, config.attraction);
+    {
+        PROFILE_SCOPE("Physics::treeBuild");
+        _tree.build(_bodyPositions, _bodyMasses, pool);
+    }
+    {
+        PROFILE_SCOPE("Physics::treeForces");
+        _tree.computeAccelerations(_attraction, pool);
+    }
+}
+void PhysicsEngine::subStep(std::shared_ptr<MyCircle>& circle, float sub_dt, const sf::Vector2f& gravity)
+{
+    // Performing leapfrog integration
+
+        // Current position + velocity
+        updatePosition(circle, sub_dt);
         
-            // Applying all forces and accumulating acceleration
-            if (_gravity)
-            {
-                applyGravity(circle, sub_dt);
-            }
+        // Applying all forces and accumulating acceleration
+        if (_gravity)
+        {
+            applyGravity(circle, sub_dt, gravity);
+        }
 
-            // Current velocity + acceleration accumulated in the frame
-            updateVelocity(circle, sub_dt);
+        // Current velocity + acceleration accumulated in the frame
+        updateVelocity(circle, sub_dt);
 
-            // Checking bounds and handling collisions with them
-            checkBounds(circle, sub_dt);
-    }
+        // Checking bounds and handling collisions with them
+        checkBounds(circle, sub_dt);
 }
 void PhysicsEngine::updatePosition(std::shared_ptr<MyCircle> circle, float deltaTime)
 {
     sf::Vector2f newPos(circle->getPositionInMetersFromPixels() + (circle->getVelocity() / (deltaTime * 60)));
     circle->setPositionFromMetersToPixels(newPos);
 }
+sf::Vector2f PhysicsEngine::toEngineVelocity(sf::Vector2f metersPerSecond, float deltaTime) const
+{
+    // A sub-step moves a circle by velocity / (subDt * 60), and integrate
+    // only runs subSteps - 1 of them per frame, so the frame's distance is
+    // spread over the passes that actually happen
+    int subSteps = Config::get().subSteps;
+    float subDt = deltaTime / static_cast<float>(subSteps);
+    int passes = std::max(1, subSteps - 1);
+    return metersPerSecond * (subDt * subDt * 60.0f * subSteps / passes);
+}
 void PhysicsEngine::drawBound(sf::RenderWindow* window)
 {
     //window->draw(*_bound);
@@ -64,9 +151,9 @@ void PhysicsEngine::drawBound(sf::RenderWindow* window)
 void PhysicsEngine::setDimensions(float conversionFactor)
 {
     Settings::setConversionFactor(conversionFactor);
-    sf::VideoMode windowRes = sf::VideoMode::getDesktopMode();
-    this->_width = static_cast<float>(windowRes.width) / Settings::getConversionFactor();
-    this->_height = static_cast<float>(windowRes.height) / Settings::getConversionFactor();
+    sf::Vector2u windowRes = World::current().getSize();
+    this->_width = static_cast<float>(windowRes.x) / Settings::getConversionFactor();
+    this->_height = static_cast<float>(windowRes.y) / Settings::getConversionFactor();
 }
 void PhysicsEngine::updateVelocity(std::shared_ptr<MyCircle> circle, float deltaTime)
 {
@@ -111,33 +198,20 @@ void PhysicsEngine::resolveCollision(std::shared_ptr<MyCircle> circle1, std::sha
     }
 }
 
-void PhysicsEngine::resolveTextCollision(std::shared_ptr<MyCircle> circle, std::shared_ptr<MyText> text)
+void PhysicsEngine::resolveTextCollision(std::shared_ptr<MyCircle> circle, std::shared_ptr<MyText> text, sf::Vector2f collisionNormal, float penetration)
 {
-    sf::Vector2f circlePosition = circle->getPositionInMetersFromPixels();
-    float circleRadius = circle->getRadiusInMetersFromPixels();
-
-    sf::Vector2f textPosition = text->_text->getPosition() / Settings::getConversionFactor();
-    sf::Vector2f textSize = sf::Vector2f(text->_text->getGlobalBounds().width / Settings::getConversionFactor(), text->_text->getGlobalBounds().height / Settings::getConversionFactor());
-
-    // Calculate the corners of the text's bounding box
-    sf::Vector2f textTopLeft = textPosition - textSize * 0.5f;
-    sf::Vector2f textBottomRight = textPosition + textSize * 0.5f;
+    // Push the circle back out of the ink so it can't settle inside a letter
+    circle->setPositionFromMetersToPixels(circle->getPositionInMetersFromPixels() + collisionNormal * penetration);
 
-    // Calculate the closest point within the text's bounding box to the circle center
-    float closestX = std::clamp(circlePosition.x, textTopLeft.x, textBottomRight.x);
-    float closestY = std::clamp(circlePosition.y, textTopLeft.y, textBottomRight.y);
-
-    // Calculate the normal vector from the collision point to the circle center
-    sf::Vector2f collisionNormal = circlePosition - sf::Vector2f(closestX, closestY);
-    float collisionNormalLength = std::sqrt(collisionNormal.x * collisionNormal.x + collisionNormal.y * collisionNormal.y);
-    collisionNormal /= collisionNormalLength;
-
-    // Calculate the reflection of the circle's velocity
+    // Reflect with the walls' restitution, a circle already moving away keeps going.
+    // Resting on the glyphs it is bounced every frame, so a gain would pump it higher each time
     sf::Vector2f circleVelocity = circle->getVelocity();
-    sf::Vector2f reflectionVelocity = circleVelocity - 2.1f * dot(circleVelocity, collisionNormal) * collisionNormal;
-
-    // Apply the reflected velocity to the circle
-    circle->setVelocity(reflectionVelocity);
+    float approach = dot(circleVelocity, collisionNormal);
+    if (approach < 0.0f)
+    {
+        float restitution = MyCircle::calculateRestitution(circle->getMass());
+        circle->setVelocity(circleVelocity - (1.0f + restitution) * approach * collisionNormal);
+    }
 
     // Apply VFX to text
     text->quickFlash();
@@ -155,9 +229,9 @@ bool PhysicsEngine::getGravityState()
     return this->_gravity;
 }
 
-void PhysicsEngine::applyGravity(std::shared_ptr<MyCircle> circle, float subDt)
+void PhysicsEngine::applyGravity(std::shared_ptr<MyCircle> circle, float subDt, const sf::Vector2f& gravity)
 {
-    sf::Vector2f scaledGrav(_gravityValue * subDt);
+    sf::Vector2f scaledGrav(gravity * subDt);
     circle->accelerate(scaledGrav);
 }
 void PhysicsEngine::checkBounds(std::shared_ptr<MyCircle> circle, float timeStep)
@@ -2,29 +2,48 @@
 #include <SFML/Graphics.hpp>
 #include "MyCircle.h"
 #include "MyText.h"
+#include "BarnesHut.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
 
 class PhysicsEngine 
 {
 public:
 	PhysicsEngine();
-	void applyPhysics(std::shared_ptr<MyCircle> circle, float deltaTime);
+	void integrate(std::vector<std::shared_ptr<MyCircle>>& circles, float deltaTime);
+	// One circle through all its sub-steps, for the reference path's per-circle order
+	void integrate(std::shared_ptr<MyCircle>& circle, float deltaTime);
 	void toggleGravity();
 	bool getGravityState();
 	void resolveCollision(std::shared_ptr<MyCircle> circle, std::shared_ptr<MyCircle> circle2);
-	void resolveTextCollision(std::shared_ptr<MyCircle> circle, std::shared_ptr<MyText> text);
+	// Normal and penetration as MyText::getContact found them
+	void resolveTextCollision(std::shared_ptr<MyCircle> circle, std::shared_ptr<MyText> text, sf::Vector2f collisionNormal, float penetration);
 	void drawBound(sf::RenderWindow* window);
 	void setDimensions(float conversionFactor);
+	// Pool sized by physics.threads, recreated when that changes
+	ThreadPool& getPool();
+	// Velocity in the integrator's units that moves a circle the given meters per second
+	sf::Vector2f toEngineVelocity(sf::Vector2f metersPerSecond, float deltaTime) const;
 	float _width;
 	float _height;
 private:
 	//std::unique_ptr<sf::CircleShape> _bound;
-	static sf::Vector2f _gravityValue;
-	static bool _gravity;
-	void applyGravity(std::shared_ptr<MyCircle> circle, float subDt);
+	sf::Vector2f _gravityValue;
+	bool _gravity;
+	// Attraction and the parallel solver, the pool is created on first use
+	std::unique_ptr<ThreadPool> _pool;
+	BarnesHut _tree;
+	std::vector<sf::Vector2f> _bodyPositions;
+	std::vector<float> _bodyMasses;
+	std::vector<sf::Vector2f> _attraction;
+	void computeAttraction(const std::vector<std::shared_ptr<MyCircle>>& circles);
+	void applyGravity(std::shared_ptr<MyCircle> circle, float subDt, const sf::Vector2f& gravity);
 	float dot(const sf::Vector2f& vec1, const sf::Vector2f& vec2);
 	float length(const sf::Vector2f& vector);
 	sf::Vector2f normalize(const sf::Vector2f& vector);
 	void checkBounds(std::shared_ptr<MyCircle> circle, float deltaTime);
+	void subStep(std::shared_ptr<MyCircle>& circle, float subDt, const sf::Vector2f& gravity);
 	void updatePosition(std::shared_ptr<MyCircle> circle, float deltaTime);
 	void updateVelocity(std::shared_ptr<MyCircle> circle, float deltaTIme);
 };
\ No newline at end of file
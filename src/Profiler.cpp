@@ -0,0 +1,268 @@
+#include "Profiler.h"
+#ifdef RSS_PROFILING
+#include "AllocTracker.h"
+#include "Counters.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+thread_local int Profiler::t_depth = 0;
+std::atomic<bool> Profiler::_traceRequested(false);
+float Profiler::_traceWindowSeconds = 10.0f;
+
+namespace
+{
+	std::mutex registryMutex;
+	std::string zoneNames[Profiler::MAX_ZONES];
+	std::atomic<int> zoneCount(0);
+
+	// Aggregated on the main thread in endFrame
+	float frameMs[Profiler::MAX_ZONES];
+	float history[Profiler::MAX_ZONES][Profiler::HISTORY_FRAMES];
+	int zoneDepth[Profiler::MAX_ZONES];
+	int historyPos = 0;
+}
+
+int Profiler::registerZone(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	int count = zoneCount.load();
+	for (int i = 0; i < count; i++)
+	{
+		if (zoneNames[i] == name)
+		{
+			return i;
+		}
+	}
+	if (count == MAX_ZONES)
+	{
+		return MAX_ZONES - 1;
+	}
+	zoneNames[count] = name;
+	zoneCount.store(count + 1);
+	return count;
+}
+
+std::int64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Scope::Scope(int zone) :
+	_zone(zone),
+	_start(now())
+{
+	t_depth++;
+#ifdef RSS_TRACK_ALLOCS
+	_allocZone = AllocTracker::swapZone(zone);
+#endif
+}
+
+Profiler::Scope::~Scope()
+{
+	t_depth--;
+#ifdef RSS_TRACK_ALLOCS
+	AllocTracker::swapZone(_allocZone);
+#endif
+	record(_zone, _start, now());
+}
+
+std::vector<Profiler::Ring*>& Profiler::rings()
+{
+	// Rings live for the whole process so the reader never sees a dangling one
+	static std::vector<Ring*>* all = new std::vector<Ring*>();
+	return *all;
+}
+
+std::vector<Profiler::Ring*>& Profiler::freeRings()
+{
+	static std::vector<Ring*>* free = new std::vector<Ring*>();
+	return *free;
+}
+
+Profiler::RingLease::~RingLease()
+{
+	if (ring)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		freeRings().push_back(ring);
+	}
+}
+
+Profiler::Ring* Profiler::threadRing()
+{
+	// Shader compilers, pool workers and capture writers come and go with config
+	// reloads, reusing their rings keeps memory at one ring per live thread
+	thread_local RingLease lease;
+	if (!lease.ring)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		if (!freeRings().empty())
+		{
+			lease.ring = freeRings().back();
+			freeRings().pop_back();
+		}
+		else
+		{
+			lease.ring = new Ring();
+			lease.ring->head.store(0);
+			lease.ring->readPos = 0;
+			lease.ring->threadId = static_cast<std::uint32_t>(rings().size());
+			rings().push_back(lease.ring);
+		}
+		lease.ring->name = "Thread " + std::to_string(lease.ring->threadId);
+	}
+	return lease.ring;
+}
+
+void Profiler::record(int zone, std::int64_t start, std::int64_t end)
+{
+	Ring* ring = threadRing();
+	std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+	Event& event = ring->events[head & (RING_CAPACITY - 1)];
+	event.start = start;
+	event.end = end;
+	event.zone = static_cast<std::uint16_t>(zone);
+	event.depth = static_cast<std::uint16_t>(t_depth);
+	event.threadId = ring->threadId;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::endFrame()
+{
+	if (_traceRequested.exchange(false))
+	{
+		std::string path = "trace_" + std::to_string(static_cast<long long>(std::time(nullptr))) + ".json";
+		if (dumpChromeTrace(path))
+		{
+			std::cout << "PROFILER: trace written to " << path << "\n";
+		}
+		else
+		{
+			std::cout << "PROFILER: failed to write " << path << "\n";
+		}
+	}
+
+	std::memset(frameMs, 0, sizeof(frameMs));
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (Ring* ring : rings())
+		{
+			std::uint64_t head = ring->head.load(std::memory_order_acquire);
+			if (head - ring->readPos > RING_CAPACITY)
+			{
+				ring->readPos = head - RING_CAPACITY;
+			}
+			for (; ring->readPos < head; ring->readPos++)
+			{
+				const Event& event = ring->events[ring->readPos & (RING_CAPACITY - 1)];
+				frameMs[event.zone] += (event.end - event.start) / 1000000.0f;
+				zoneDepth[event.zone] = event.depth;
+			}
+		}
+	}
+	for (int zone = 0; zone < MAX_ZONES; zone++)
+	{
+		history[zone][historyPos] = frameMs[zone];
+	}
+	historyPos = (historyPos + 1) % HISTORY_FRAMES;
+	Counters::endFrame();
+}
+
+int Profiler::getZoneCount()
+{
+	return zoneCount.load();
+}
+
+const char* Profiler::getZoneName(int zone)
+{
+	return zoneNames[zone].c_str();
+}
+
+Profiler::ZoneStats Profiler::getStats(int zone)
+{
+	ZoneStats stats;
+	stats.currentMs = frameMs[zone];
+	stats.averageMs = 0.0f;
+	stats.maxMs = 0.0f;
+	stats.depth = zoneDepth[zone];
+	for (int i = 0; i < HISTORY_FRAMES; i++)
+	{
+		stats.averageMs += history[zone][i];
+		stats.maxMs = std::max(stats.maxMs, history[zone][i]);
+	}
+	stats.averageMs /= HISTORY_FRAMES;
+	return stats;
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	Ring* ring = threadRing();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	ring->name = name;
+}
+
+void Profiler::setTraceWindow(float seconds)
+{
+	_traceWindowSeconds = seconds;
+}
+
+void Profiler::requestTraceDump()
+{
+	// Only touches a lock-free atomic, safe to call from a signal handler
+	_traceRequested.store(true);
+}
+
+void Profiler::installSignalHandler()
+{
+#ifdef SIGUSR1
+	std::signal(SIGUSR1, [](int) { requestTraceDump(); });
+#endif
+}
+
+bool Profiler::dumpChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::int64_t cutoff = now() - static_cast<std::int64_t>(_traceWindowSeconds * 1e9);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (Ring* ring : rings())
+	{
+		file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->threadId
+			<< ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+		first = false;
+
+		// Leave a margin at the tail, the owning thread may be overwriting it right now
+		std::uint64_t head = ring->head.load(std::memory_order_acquire);
+		std::uint64_t available = std::min<std::uint64_t>(head, RING_CAPACITY - 1024);
+		for (std::uint64_t i = head - available; i < head; i++)
+		{
+			const Event& event = ring->events[i & (RING_CAPACITY - 1)];
+			if (event.end < cutoff)
+			{
+				continue;
+			}
+			file << ",\n{\"ph\":\"X\",\"name\":\"" << zoneNames[event.zone]
+				<< "\",\"pid\":1,\"tid\":" << event.threadId
+				<< ",\"ts\":" << event.start / 1000 << "." << (event.start % 1000) / 100
+				<< ",\"dur\":" << (event.end - event.start) / 1000 << "." << ((event.end - event.start) % 1000) / 100 << "}";
+		}
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
+
+#endif
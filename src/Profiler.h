@@ -0,0 +1,102 @@
+#pragma once
+// Scoped timing zones. Build with RSS_PROFILING defined to enable them,
+// without it PROFILE_SCOPE and PROFILE_FRAME compile to nothing.
+#ifdef RSS_PROFILING
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define RSS_CONCAT_INNER(a, b) a##b
+#define RSS_CONCAT(a, b) RSS_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) \
+	static const int RSS_CONCAT(_profileZone, __LINE__) = Profiler::registerZone(name); \
+	Profiler::Scope RSS_CONCAT(_profileScope, __LINE__)(RSS_CONCAT(_profileZone, __LINE__))
+#define PROFILE_ZONE(zone) Profiler::Scope RSS_CONCAT(_profileScope, __LINE__)(zone)
+#define PROFILE_REGISTER(name) Profiler::registerZone(name)
+#define PROFILE_FRAME() Profiler::endFrame()
+
+class Profiler
+{
+public:
+	static const int MAX_ZONES = 128;
+	static const int HISTORY_FRAMES = 120;
+
+	struct Event
+	{
+		std::int64_t start;
+		std::int64_t end;
+		std::uint16_t zone;
+		std::uint16_t depth;
+		std::uint32_t threadId;
+	};
+	struct ZoneStats
+	{
+		float currentMs;
+		float averageMs;
+		float maxMs;
+		int depth;
+	};
+
+	class Scope
+	{
+	public:
+		Scope(int zone);
+		~Scope();
+	private:
+		int _zone;
+		std::int64_t _start;
+#ifdef RSS_TRACK_ALLOCS
+		int _allocZone;
+#endif
+	};
+
+	static int registerZone(const std::string& name);
+	static std::int64_t now();
+	static void endFrame();
+	static int getZoneCount();
+	static const char* getZoneName(int zone);
+	static ZoneStats getStats(int zone);
+
+	// Chrome trace-event export of the last few seconds, loadable in
+	// chrome://tracing or Perfetto. Requests are served at the next endFrame.
+	static void setThreadName(const std::string& name);
+	static void setTraceWindow(float seconds);
+	static void requestTraceDump();
+	static void installSignalHandler();
+	static bool dumpChromeTrace(const std::string& path);
+
+private:
+	// One single-producer ring per live thread, the frame aggregator is the only reader.
+	// A thread's ring goes to a free list when it exits and the next new thread takes it
+	static const std::uint32_t RING_CAPACITY = 1 << 18;
+	struct Ring
+	{
+		std::atomic<std::uint64_t> head;
+		std::uint64_t readPos;
+		std::uint32_t threadId;
+		std::string name;
+		Event events[RING_CAPACITY];
+	};
+	struct RingLease
+	{
+		Ring* ring = nullptr;
+		~RingLease();
+	};
+	static std::vector<Ring*>& rings();
+	static std::vector<Ring*>& freeRings();
+	static Ring* threadRing();
+	static void record(int zone, std::int64_t start, std::int64_t end);
+	static thread_local int t_depth;
+	static std::atomic<bool> _traceRequested;
+	static float _traceWindowSeconds;
+};
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_ZONE(zone)
+#define PROFILE_REGISTER(name) 0
+#define PROFILE_FRAME()
+
+#endif
@@ -0,0 +1,204 @@
+#include "QueryCheck.h"
+#include "GameManager.h"
+#include "SpatialGrid.h"
+#include "Random.h"
+#include "Settings.h"
+#include "World.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	const float FIXED_DT = 1.0f / 144.0f;
+	const sf::Vector2u WORLD_SIZE(1920, 1080);
+	const int SAMPLES = 2000;
+	// Queries start up to this share of the world outside it
+	const float OUTSIDE = 0.1f;
+	const float MAX_QUERY_RADIUS = 5.0f;
+	// Relative to the hit distance
+	const float RAY_TOLERANCE = 1e-5f;
+
+	struct Circles
+	{
+		std::vector<sf::Vector2f> positions;
+		std::vector<float> radii;
+	};
+
+	void bruteRadius(const Circles& circles, sf::Vector2f center, float radius, std::vector<int>& out)
+	{
+		out.clear();
+		for (int i = 0; i < static_cast<int>(circles.positions.size()); i++)
+		{
+			sf::Vector2f d = circles.positions[i] - center;
+			float limit = radius + circles.radii[i];
+			if (d.x * d.x + d.y * d.y <= limit * limit)
+			{
+				out.push_back(i);
+			}
+		}
+	}
+
+	void bruteRect(const Circles& circles, sf::Vector2f min, sf::Vector2f max, std::vector<int>& out)
+	{
+		out.clear();
+		for (int i = 0; i < static_cast<int>(circles.positions.size()); i++)
+		{
+			sf::Vector2f p = circles.positions[i];
+			float dx = p.x - std::clamp(p.x, min.x, max.x);
+			float dy = p.y - std::clamp(p.y, min.y, max.y);
+			if (dx * dx + dy * dy <= circles.radii[i] * circles.radii[i])
+			{
+				out.push_back(i);
+			}
+		}
+	}
+
+	// Squared distance to the centre of the picked circle, infinite for none
+	float pickDistance(const Circles& circles, int picked, sf::Vector2f point)
+	{
+		if (picked < 0)
+		{
+			return std::numeric_limits<float>::infinity();
+		}
+		sf::Vector2f d = circles.positions[picked] - point;
+		return d.x * d.x + d.y * d.y;
+	}
+
+	int brutePick(const Circles& circles, sf::Vector2f point)
+	{
+		int best = -1;
+		for (int i = 0; i < static_cast<int>(circles.positions.size()); i++)
+		{
+			float distance = pickDistance(circles, i, point);
+			if (distance <= circles.radii[i] * circles.radii[i] && distance < pickDistance(circles, best, point))
+			{
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	int bruteRaycast(const Circles& circles, sf::Vector2f origin, sf::Vector2f direction, float maxDistance, float& hitDistance)
+	{
+		// Normalised as the grid does it, grazing hits turn on the last bit
+		direction /= std::sqrt(direction.x * direction.x + direction.y * direction.y);
+		int hit = -1;
+		float best = maxDistance;
+		for (int i = 0; i < static_cast<int>(circles.positions.size()); i++)
+		{
+			sf::Vector2f m = origin - circles.positions[i];
+			float b = m.x * direction.x + m.y * direction.y;
+			float c = m.x * m.x + m.y * m.y - circles.radii[i] * circles.radii[i];
+			float t = 0.0f;
+			if (c > 0.0f)
+			{
+				float discriminant = b * b - c;
+				if (b > 0.0f || discriminant < 0.0f)
+				{
+					continue;
+				}
+				t = -b - std::sqrt(discriminant);
+			}
+			if (t < best)
+			{
+				best = t;
+				hit = i;
+			}
+		}
+		if (hit >= 0)
+		{
+			hitDistance = best;
+		}
+		return hit;
+	}
+}
+
+QueryCheck::QueryCheck(std::shared_ptr<sf::Font> font, std::uint32_t seed, int frames) :
+	_font(font),
+	_seed(seed),
+	_frames(frames)
+{
+}
+
+int QueryCheck::run()
+{
+	World world(0, WORLD_SIZE, _seed);
+	World::setCurrent(&world);
+	int radiusErrors = 0;
+	int rectErrors = 0;
+	int pickErrors = 0;
+	int rayErrors = 0;
+	int rayHits = 0;
+	{
+		GameManager game(nullptr, _font);
+		for (int i = 0; i < _frames; i++)
+		{
+			game.step(FIXED_DT);
+		}
+		Circles circles;
+		for (const auto& circle : game.getCircles())
+		{
+			circles.positions.push_back(circle->getPositionInMetersFromPixels());
+			circles.radii.push_back(circle->getRadiusInMetersFromPixels());
+		}
+		float width = WORLD_SIZE.x / Settings::getConversionFactor();
+		float height = WORLD_SIZE.y / Settings::getConversionFactor();
+		SpatialGrid grid;
+		grid.build(game.getCircles(), width, height);
+		std::cout << "QUERIES: " << circles.positions.size() << " circles after " << _frames << " frames, seed " << _seed << ", "
+			<< SAMPLES << " samples per query" << "\n";
+
+		auto randomPoint = [&]() {
+			return sf::Vector2f(Random::uniform(-OUTSIDE * width, (1.0f + OUTSIDE) * width),
+				Random::uniform(-OUTSIDE * height, (1.0f + OUTSIDE) * height));
+		};
+		std::vector<int> expected;
+		std::vector<int> actual;
+		for (int s = 0; s < SAMPLES; s++)
+		{
+			sf::Vector2f center = randomPoint();
+			float radius = Random::uniform(0.0f, MAX_QUERY_RADIUS);
+			bruteRadius(circles, center, radius, expected);
+			grid.queryRadius(center, radius, actual);
+			std::sort(actual.begin(), actual.end());
+			radiusErrors += actual != expected;
+
+			sf::Vector2f corner = randomPoint();
+			sf::Vector2f other = randomPoint();
+			sf::Vector2f min(std::min(corner.x, other.x), std::min(corner.y, other.y));
+			sf::Vector2f max(std::max(corner.x, other.x), std::max(corner.y, other.y));
+			bruteRect(circles, min, max, expected);
+			grid.queryRect(min, max, actual);
+			std::sort(actual.begin(), actual.end());
+			rectErrors += actual != expected;
+
+			// Ties between equally near centres may go either way
+			sf::Vector2f point = randomPoint();
+			int picked = grid.pick(point);
+			pickErrors += pickDistance(circles, picked, point) != pickDistance(circles, brutePick(circles, point), point);
+
+			float angle = Random::uniform(0.0f, 6.2831853f);
+			sf::Vector2f direction(std::cos(angle), std::sin(angle));
+			float maxDistance = Random::uniform(0.0f, width + height);
+			float expectedDistance = 0.0f;
+			float actualDistance = 0.0f;
+			int expectedHit = bruteRaycast(circles, point, direction, maxDistance, expectedDistance);
+			int actualHit = grid.raycast(point, direction, maxDistance, actualDistance);
+			rayHits += expectedHit >= 0;
+			if ((expectedHit < 0) != (actualHit < 0) || (expectedHit >= 0 && std::abs(expectedDistance - actualDistance) > RAY_TOLERANCE * std::max(1.0f, expectedDistance)))
+			{
+				rayErrors++;
+			}
+		}
+	}
+	World::setCurrent(nullptr);
+
+	std::cout << "QUERIES: radius " << radiusErrors << " wrong, rect " << rectErrors << " wrong, pick " << pickErrors
+		<< " wrong, raycast " << rayErrors << " wrong (" << rayHits << " rays hit)" << "\n";
+	int errors = radiusErrors + rectErrors + pickErrors + rayErrors;
+	std::cout << "QUERIES: " << (errors == 0 ? "grid matches brute force" : "FAILED") << "\n";
+	return errors;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+
+// Checks the grid's queries against testing every circle. A headless world
+// is stepped until the circles have spread and piled up, then random discs,
+// boxes, points and rays, some reaching past the world bounds, are answered
+// both ways and must agree.
+class QueryCheck
+{
+public:
+	QueryCheck(std::shared_ptr<sf::Font> font, std::uint32_t seed, int frames);
+	// Returns the number of queries the grid got wrong
+	int run();
+private:
+	std::shared_ptr<sf::Font> _font;
+	std::uint32_t _seed;
+	int _frames;
+};
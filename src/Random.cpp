@@ -0,0 +1,30 @@
+#include "Random.h"
+#include "World.h"
+
+void Random::seed(std::uint32_t seed)
+{
+	World::current().seed = seed;
+	engine().seed(seed);
+}
+
+std::uint32_t Random::getSeed()
+{
+	return World::current().seed;
+}
+
+float Random::uniform(float min, float max)
+{
+	std::uniform_real_distribution<float> dis(min, max);
+	return dis(engine());
+}
+
+int Random::uniformInt(int min, int max)
+{
+	std::uniform_int_distribution<int> dis(min, max);
+	return dis(engine());
+}
+
+std::mt19937& Random::engine()
+{
+	return World::current().random;
+}
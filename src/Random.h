@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+// Random stream of the current world. Seeded from std::random_device unless a
+// scenario or replay fixes the seed, so those runs are repeatable.
+class Random
+{
+public:
+	static void seed(std::uint32_t seed);
+	static std::uint32_t getSeed();
+	static float uniform(float min, float max);
+	static int uniformInt(int min, int max);
+private:
+	static std::mt19937& engine();
+};
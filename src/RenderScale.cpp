@@ -0,0 +1,101 @@
+#include "RenderScale.h"
+#include <algorithm>
+#include <cmath>
+
+const float RenderScale::MIN_SCALE = 0.5f;
+const float RenderScale::MAX_SCALE = 1.0f;
+const float RenderScale::STEP = 0.05f;
+const int RenderScale::SAMPLE_INTERVAL = 10;
+const int RenderScale::COOLDOWN_SAMPLES = 3;
+
+RenderScale::RenderScale(float scale, bool automatic, float budgetMs) :
+	_scale(quantize(scale)),
+	_automatic(automatic),
+	_budgetMs(budgetMs),
+	_averageMs(budgetMs),
+	_cooldown(COOLDOWN_SAMPLES),
+	_frame(0)
+{
+}
+
+float RenderScale::getScale() const
+{
+	return _scale;
+}
+
+bool RenderScale::isAutomatic() const
+{
+	return _automatic;
+}
+
+void RenderScale::setFixed(float scale)
+{
+	_automatic = false;
+	_scale = quantize(scale);
+}
+
+void RenderScale::setAutomatic(float budgetMs)
+{
+	_automatic = true;
+	_budgetMs = budgetMs;
+	_averageMs = budgetMs;
+	_cooldown = COOLDOWN_SAMPLES;
+}
+
+bool RenderScale::shouldSample()
+{
+	_frame = (_frame + 1) % SAMPLE_INTERVAL;
+	return _automatic && _frame == 0;
+}
+
+// Returns true when the scale changed and render targets need recreating
+bool RenderScale::update(float gpuFrameMs)
+{
+	if (!_automatic)
+	{
+		return false;
+	}
+
+	// Smooth out single slow frames before reacting, samples are SAMPLE_INTERVAL frames apart
+	_averageMs += (gpuFrameMs - _averageMs) * 0.3f;
+	if (_cooldown > 0)
+	{
+		_cooldown--;
+		return false;
+	}
+
+	// One step at a time, with a dead band so the scale doesn't oscillate
+	float target = _scale;
+	if (_averageMs > _budgetMs * 1.05f)
+	{
+		target = _scale - STEP;
+	}
+	else if (_averageMs < _budgetMs * 0.75f)
+	{
+		target = _scale + STEP;
+	}
+	target = quantize(target);
+	if (target == _scale)
+	{
+		return false;
+	}
+
+	// Assume cost scales with pixel count so the new average starts near its real value
+	_averageMs *= (target * target) / (_scale * _scale);
+	_scale = target;
+	_cooldown = COOLDOWN_SAMPLES;
+	return true;
+}
+
+sf::Vector2u RenderScale::apply(sf::Vector2u windowSize) const
+{
+	return sf::Vector2u(
+		std::max(1u, static_cast<unsigned int>(std::lround(windowSize.x * _scale))),
+		std::max(1u, static_cast<unsigned int>(std::lround(windowSize.y * _scale))));
+}
+
+float RenderScale::quantize(float scale) const
+{
+	float clamped = std::clamp(scale, MIN_SCALE, MAX_SCALE);
+	return std::round(clamped / STEP) * STEP;
+}
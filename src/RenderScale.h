@@ -0,0 +1,32 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+
+// Internal render resolution as a fraction of the window size.
+// In auto mode the scale follows the measured GPU frame time towards a budget.
+// Measuring needs a CPU/GPU fence, so only one frame in SAMPLE_INTERVAL is timed.
+class RenderScale
+{
+public:
+	RenderScale(float scale, bool automatic, float budgetMs);
+	float getScale() const;
+	bool isAutomatic() const;
+	void setFixed(float scale);
+	void setAutomatic(float budgetMs);
+	// Counts a frame, true when this one should be fenced and timed
+	bool shouldSample();
+	bool update(float gpuFrameMs);
+	sf::Vector2u apply(sf::Vector2u windowSize) const;
+private:
+	static const float MIN_SCALE;
+	static const float MAX_SCALE;
+	static const float STEP;
+	static const int SAMPLE_INTERVAL;
+	static const int COOLDOWN_SAMPLES;
+	float _scale;
+	bool _automatic;
+	float _budgetMs;
+	float _averageMs;
+	int _cooldown;
+	int _frame;
+	float quantize(float scale) const;
+};
@@ -0,0 +1,349 @@
+#include "Scenario.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+#include "Random.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+const float Scenario::FIXED_DT = 1.0f / 144.0f;
+
+namespace
+{
+	// Phases shorter than this are reported but too noisy to gate on
+	const int MIN_COMPARE_FRAMES = 10;
+
+	struct PhaseTiming
+	{
+		float meanMs;
+		float p99Ms;
+		int frames;
+	};
+
+	bool readNumber(const std::string& text, const std::string& key, size_t from, size_t to, float& value)
+	{
+		size_t pos = text.find("\"" + key + "\":", from);
+		if (pos == std::string::npos || pos > to)
+		{
+			return false;
+		}
+		value = std::stof(text.substr(pos + key.size() + 3));
+		return true;
+	}
+
+	// Reads back the phases of a file written by Scenario::writeJson
+	bool readPhases(const std::string& path, std::vector<std::pair<std::string, PhaseTiming>>& phases)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cout << "SCENARIO: failed to open " << path << "\n";
+			return false;
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		std::string text = buffer.str();
+
+		const std::string nameKey = "{\"name\":\"";
+		size_t pos = text.find(nameKey);
+		while (pos != std::string::npos)
+		{
+			size_t nameStart = pos + nameKey.size();
+			size_t nameEnd = text.find('"', nameStart);
+			size_t next = text.find(nameKey, nameEnd);
+			size_t end = next == std::string::npos ? text.size() : next;
+			PhaseTiming timing;
+			float frames = 0.0f;
+			if (nameEnd == std::string::npos
+				|| !readNumber(text, "frames", nameEnd, end, frames)
+				|| !readNumber(text, "meanMs", nameEnd, end, timing.meanMs)
+				|| !readNumber(text, "p99Ms", nameEnd, end, timing.p99Ms))
+			{
+				std::cout << "SCENARIO: malformed phase in " << path << "\n";
+				return false;
+			}
+			timing.frames = static_cast<int>(frames);
+			phases.emplace_back(text.substr(nameStart, nameEnd - nameStart), timing);
+			pos = next;
+		}
+		return true;
+	}
+}
+
+Scenario::Scenario() :
+	_seed(1)
+{
+}
+
+bool Scenario::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cout << "SCENARIO: failed to open " << path << "\n";
+		return false;
+	}
+	_path = path;
+	_steps.clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line = line.substr(0, comment);
+		}
+		std::istringstream words(line);
+		Step step;
+		if (!(words >> step.command))
+		{
+			continue;
+		}
+		step.amount = 0;
+		step.frames = 1;
+		if (step.command == "seed")
+		{
+			words >> _seed;
+			continue;
+		}
+		else if (step.command == "intro")
+		{
+			step.frames = 20000;
+			words >> step.frames;
+		}
+		else if (step.command == "spawn")
+		{
+			if (!(words >> step.amount >> step.frames) || step.frames < 1)
+			{
+				std::cout << "SCENARIO: line " << lineNumber << ": spawn needs <total> <frames>" << "\n";
+				return false;
+			}
+		}
+		else if (step.command == "settle")
+		{
+			if (!(words >> step.frames) || step.frames < 1)
+			{
+				std::cout << "SCENARIO: line " << lineNumber << ": settle needs <frames>" << "\n";
+				return false;
+			}
+		}
+		else if (step.command != "gravity" && step.command != "shake" && step.command != "clear")
+		{
+			std::cout << "SCENARIO: line " << lineNumber << ": unknown step '" << step.command << "'" << "\n";
+			return false;
+		}
+
+		// Phase names carry the step index so repeated steps stay distinct
+		std::ostringstream name;
+		name << _steps.size() << " " << step.command;
+		if (step.command == "spawn")
+		{
+			name << " " << step.amount;
+		}
+		else if (step.command == "settle")
+		{
+			name << " " << step.frames;
+		}
+		step.name = name.str();
+		_steps.push_back(step);
+	}
+	std::cout << "SCENARIO: " << path << " loaded, " << _steps.size() << " steps" << "\n";
+	return !_steps.empty();
+}
+
+void Scenario::setSeed(std::uint32_t seed)
+{
+	_seed = seed;
+}
+
+std::uint32_t Scenario::getSeed() const
+{
+	return _seed;
+}
+
+bool Scenario::run(GameManager& game, sf::RenderWindow* window)
+{
+	Random::seed(_seed);
+	_phases.clear();
+	for (const Step& step : _steps)
+	{
+		{
+			// The bookkeeping between steps isn't part of the frames being measured
+			ALLOC_EXEMPT();
+			_phases.emplace_back();
+			_phases.back().name = step.name;
+			_phases.back().frames = 0;
+			_phases.back().totalMs = 0.0f;
+			std::cout << "SCENARIO: " << step.name << "\n";
+		}
+		Phase& phase = _phases.back();
+		if (!runStep(step, game, window, phase))
+		{
+			std::cout << "SCENARIO: aborted during " << step.name << "\n";
+			return false;
+		}
+		for (auto& zone : phase.zoneMs)
+		{
+			zone.second /= phase.frames;
+		}
+	}
+	return true;
+}
+
+bool Scenario::runStep(const Step& step, GameManager& game, sf::RenderWindow* window, Phase& phase)
+{
+	sf::Clock clock;
+#ifdef RSS_PROFILING
+	_zoneTotals.assign(Profiler::MAX_ZONES, 0.0f);
+#endif
+	for (int frame = 0; frame < step.frames; frame++)
+	{
+		if (window && !window->isOpen())
+		{
+			return false;
+		}
+		if (step.command == "intro" && GameManager::isIntroFinished())
+		{
+			break;
+		}
+
+		clock.restart();
+		if (frame == 0)
+		{
+			if (step.command == "gravity")
+			{
+				game.toggleGravity();
+			}
+			else if (step.command == "shake")
+			{
+				game.shake();
+			}
+			else if (step.command == "clear")
+			{
+				game.clear();
+			}
+		}
+		if (step.command == "spawn")
+		{
+			// Spread the remaining circles evenly over the remaining frames
+			int missing = step.amount - GameManager::getObjectCount();
+			if (missing > 0)
+			{
+				game.spawnCircles((missing + step.frames - frame - 1) / (step.frames - frame));
+			}
+		}
+		game.step(FIXED_DT);
+		float frameMs = clock.getElapsedTime().asSeconds() * 1000.0f;
+
+		phase.frames++;
+		phase.totalMs += frameMs;
+		phase.histogram.record(frameMs / 1000.0f);
+#ifdef RSS_PROFILING
+		for (int zone = 0; zone < Profiler::getZoneCount(); zone++)
+		{
+			_zoneTotals[zone] += Profiler::getStats(zone).currentMs;
+		}
+#endif
+	}
+#ifdef RSS_PROFILING
+	{
+		ALLOC_EXEMPT();
+		for (int zone = 0; zone < Profiler::getZoneCount(); zone++)
+		{
+			phase.zoneMs[Profiler::getZoneName(zone)] += _zoneTotals[zone];
+		}
+	}
+#endif
+	if (step.command == "intro" && !GameManager::isIntroFinished())
+	{
+		std::cout << "SCENARIO: intro did not finish within " << step.frames << " frames" << "\n";
+	}
+	return true;
+}
+
+bool Scenario::writeJson(const std::string& path, bool headless) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "SCENARIO: failed to write " << path << "\n";
+		return false;
+	}
+	file << std::fixed << std::setprecision(3);
+	file << "{\"scenario\":\"" << _path << "\",\"seed\":" << _seed << ",\"headless\":" << (headless ? "true" : "false")
+		<< ",\"dt\":" << FIXED_DT << ",\"phases\":[\n";
+	for (size_t i = 0; i < _phases.size(); i++)
+	{
+		const Phase& phase = _phases[i];
+		file << (i == 0 ? "" : ",\n") << "{\"name\":\"" << phase.name << "\",\"frames\":" << phase.frames
+			<< ",\"meanMs\":" << (phase.frames > 0 ? phase.totalMs / phase.frames : 0.0f)
+			<< ",\"p50Ms\":" << phase.histogram.getPercentileMs(50.0f)
+			<< ",\"p95Ms\":" << phase.histogram.getPercentileMs(95.0f)
+			<< ",\"p99Ms\":" << phase.histogram.getPercentileMs(99.0f)
+			<< ",\"maxMs\":" << phase.histogram.getMaxMs()
+			<< ",\"zones\":{";
+		bool first = true;
+		for (const auto& zone : phase.zoneMs)
+		{
+			file << (first ? "" : ",") << "\"" << zone.first << "\":" << zone.second;
+			first = false;
+		}
+		file << "}}";
+	}
+	file << "\n]}\n";
+	std::cout << "SCENARIO: results written to " << path << "\n";
+	return static_cast<bool>(file);
+}
+
+int Scenario::compare(const std::string& baselinePath, const std::string& currentPath, float thresholdPercent)
+{
+	std::vector<std::pair<std::string, PhaseTiming>> baseline;
+	std::vector<std::pair<std::string, PhaseTiming>> current;
+	if (!readPhases(baselinePath, baseline) || !readPhases(currentPath, current))
+	{
+		return -1;
+	}
+
+	float limit = 1.0f + thresholdPercent / 100.0f;
+	int regressions = 0;
+	std::cout << std::fixed << std::setprecision(2);
+	for (const auto& phase : current)
+	{
+		const PhaseTiming* base = nullptr;
+		for (const auto& candidate : baseline)
+		{
+			if (candidate.first == phase.first)
+			{
+				base = &candidate.second;
+				break;
+			}
+		}
+		if (!base)
+		{
+			std::cout << "SCENARIO: " << phase.first << " not in baseline" << "\n";
+			continue;
+		}
+		bool regressed = phase.second.frames >= MIN_COMPARE_FRAMES
+			&& (phase.second.meanMs > base->meanMs * limit || phase.second.p99Ms > base->p99Ms * limit);
+		std::cout << "SCENARIO: " << std::left << std::setw(20) << phase.first << std::right
+			<< " mean " << base->meanMs << " -> " << phase.second.meanMs
+			<< "  p99 " << base->p99Ms << " -> " << phase.second.p99Ms;
+		if (phase.second.frames < MIN_COMPARE_FRAMES)
+		{
+			std::cout << "  (too short)";
+		}
+		else if (regressed)
+		{
+			std::cout << "  REGRESSION";
+			regressions++;
+		}
+		std::cout << "\n";
+	}
+	std::cout << std::defaultfloat;
+	std::cout << "SCENARIO: " << regressions << " phases regressed by more than " << thresholdPercent << "%" << "\n";
+	return regressions;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "GameManager.h"
+#include "FrameHistogram.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Scripted performance run. A scenario file lists steps, one per line:
+//   seed <n>                 fixes the random stream
+//   intro [maxFrames]        runs until the intro has finished
+//   spawn <total> <frames>   spawns circles up to <total>, spread over <frames>
+//   gravity | shake | clear  one-frame actions
+//   settle <frames>          runs without input
+// Every step is timed at a fixed dt and written as one phase of the JSON result.
+class Scenario
+{
+public:
+	Scenario();
+	bool load(const std::string& path);
+	void setSeed(std::uint32_t seed);
+	std::uint32_t getSeed() const;
+	bool run(GameManager& game, sf::RenderWindow* window);
+	bool writeJson(const std::string& path, bool headless) const;
+	// Compares two result files, returns the number of regressed phases or -1 on error
+	static int compare(const std::string& baselinePath, const std::string& currentPath, float thresholdPercent);
+private:
+	static const float FIXED_DT;
+	struct Step
+	{
+		std::string command;
+		int amount;
+		int frames;
+		std::string name;
+	};
+	struct Phase
+	{
+		std::string name;
+		int frames;
+		float totalMs;
+		FrameHistogram histogram;
+		std::map<std::string, float> zoneMs;
+	};
+	std::string _path;
+	std::uint32_t _seed;
+	std::vector<Step> _steps;
+	std::vector<Phase> _phases;
+	// Zone times of the running step by zone index, naming them every frame would allocate
+	std::vector<float> _zoneTotals;
+	bool runStep(const Step& step, GameManager& game, sf::RenderWindow* window, Phase& phase);
+};
@@ -1,14 +1,14 @@
 #include "Settings.h"
-float Settings::_conversionFactor = 1.0f;
+#include "World.h"
 
 float Settings::getConversionFactor()
 {
-    return _conversionFactor;
+    return World::current().conversionFactor;
 }
 
 void Settings::setConversionFactor(float convFact)
 {
-    _conversionFactor = convFact;
+    World::current().conversionFactor = convFact;
     
 }
 
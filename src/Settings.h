@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+// Pixels per meter of the current world, see World
 class Settings 
 {
 public:
@@ -9,6 +10,5 @@ public:
 	//void setSubSteps(uint32_t steps);
 	//static float getTimeStep();
 private:
-	static float _conversionFactor;
 	//static uint32_t _subStep;
 };
\ No newline at end of file
@@ -1,87 +1,567 @@
 #include "Shaders.h"
+#include "Assets.h"
+#include "Counters.h"
+#include "Profiler.h"
+#include <SFML/OpenGL.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
-Shaders::Shaders(sf::RenderWindow* window):
-    GameWindow(window)
+namespace
 {
-    // Load shaders
-    if (!bloomX.loadFromFile("Shaders/BloomX.frag", sf::Shader::Fragment))
+    struct OpInfo
     {
-        std::cout << "SHADERS: Failed to load BloomX.frag" << "\n";
+        std::string type;
+        std::string file;
+        bool pointWise;
+        size_t inputs;
+        std::vector<std::pair<std::string, float>> params;
+    };
+
+    // Every pass type the graph understands. Point-wise passes are GLSL functions
+    // of the form vec4 type(vec4 input..., vec2 uv, float param...) and get fused,
+    // the rest are complete fragment shaders run as their own full-screen draw.
+    const std::vector<OpInfo> OPS =
+    {
+        { "blurX",    "Shaders/BloomX.frag",    false, 1, { { "sigma", 5.0f }, { "glow", 1.0f } } },
+        { "blurY",    "Shaders/BloomY.frag",    false, 1, { { "sigma", 5.0f }, { "glow", 1.0f } } },
+        { "combine",  "Shaders/Combine.glsl",   true,  2, { { "strength", 1.0f } } },
+        { "tonemap",  "Shaders/Tonemap.glsl",   true,  1, { { "exposure", 1.0f } } },
+        { "scanline", "Shaders/Scanline.glsl",  true,  1, { { "intensity", 0.2f }, { "vignette", 0.3f } } }
+    };
+
+    // Used when PostProcess.cfg is missing or invalid
+    const char* DEFAULT_GRAPH =
+        "blurX    scene        -> blurX   sigma=5 glow=1\n"
+        "blurY    blurX        -> bloom   sigma=5 glow=1\n"
+        "combine  scene,bloom  -> lit     strength=2\n"
+        "tonemap  lit          -> mapped  exposure=2\n"
+        "scanline mapped       -> screen  intensity=0.15 vignette=0.3\n";
+
+    const std::string SCENE = "scene";
+    const std::string SCREEN = "screen";
+
+    const OpInfo* findOp(const std::string& type)
+    {
+        for (const OpInfo& op : OPS)
+        {
+            if (op.type == type)
+            {
+                return &op;
+            }
+        }
+        return nullptr;
     }
-    else
+}
+
+Shaders::Shaders(sf::RenderWindow* window, sf::Vector2u resolution, const std::string& bloomQuality):
+    GameWindow(window),
+    _windowSize(window->getSize()),
+    _resolution(0, 0),
+    _kernelSigmas(0.0f),
+    _ready(false),
+    _failed(!sf::Shader::isAvailable())
+{
+    // Blur reach in standard deviations, "ultra" keeps the fixed 50-tap kernel
+    if (bloomQuality == "low")
     {
-        std::cout << "SHADERS: BloomX.frag - SUCCESS" << "\n";
+        _kernelSigmas = 2.0f;
     }
-    if (!bloomY.loadFromFile("Shaders/BloomY.frag", sf::Shader::Fragment))
+    else if (bloomQuality == "medium")
     {
-        std::cout << "SHADERS: Failed to load BloomY.frag" << "\n";
+        _kernelSigmas = 3.0f;
     }
-    else
+    else if (bloomQuality == "high")
     {
-        std::cout << "SHADERS: BloomY.frag - SUCCESS" << "\n";
+        _kernelSigmas = 4.0f;
     }
-    if (!add.loadFromFile("Shaders/add.frag", sf::Shader::Fragment))
+
+    // Load graph
+    std::string graph;
+    std::istringstream file;
+    bool found = Assets::getText("Shaders/PostProcess.cfg", graph);
+    file.str(graph);
+    if (!found || !parseGraph(file) || !validateGraph())
     {
-        std::cout << "SHADERS: Failed to load add.frag" << "\n";
+        std::cout << "SHADERS: Failed to load PostProcess.cfg, using default graph" << "\n";
+        std::istringstream fallback(DEFAULT_GRAPH);
+        _passes.clear();
+        parseGraph(fallback);
     }
     else
     {
-        std::cout << "SHADERS: add.frag - SUCCESS" << "\n";
-    }
-
-    // setUniforms
-    float sigma = 5.0f;
-    float glowMultiplier = 1.0f;
-    float width = GameWindow->getSize().x;
-    float height = GameWindow->getSize().y;
-
-    bloomX.setUniform("sigma", sigma);
-    bloomX.setUniform("glowMultiplier", glowMultiplier);
-    bloomX.setUniform("width", width);
-
-    bloomY.setUniform("sigma", sigma);
-    bloomY.setUniform("glowMultiplier", glowMultiplier);
-    bloomY.setUniform("height", height);
-}
-
-void Shaders::applyBloom(std::shared_ptr<sf::RenderTexture> xRenderTexture)
-{ 
-    // Create temp textures
-    sf::RenderTexture tempTexture;
-    sf::RenderTexture yRenderTexture;
-    sf::Sprite sprite(xRenderTexture->getTexture());
-    sf::Texture sourceTexture(xRenderTexture->getTexture());
-    if (!tempTexture.create(GameWindow->getSize().x, GameWindow->getSize().y)) 
-    {
-        std::cout << "SHADERS: failed to create tempTexture" << "\n";
-    }
-    if (!yRenderTexture.create(GameWindow->getSize().x, GameWindow->getSize().y))
-    {
-        std::cout << "SHADERS: failed to create yRenderTexture" << "\n";
-    }
-    
-    bloomX.setUniform("sourceTexture", sourceTexture);
-    bloomY.setUniform("sourceTexture", sourceTexture);
-    
-    // X bloom
-    xRenderTexture->draw(sprite, &bloomX);
-    xRenderTexture->display();
-    // Y bloom
-    yRenderTexture.draw(sprite, &bloomY);
-    yRenderTexture.display();
-   
-    //Add X + Y
-    add.setUniform("source", xRenderTexture->getTexture());
-    add.setUniform("bloom", yRenderTexture.getTexture());    
-    tempTexture.draw(sprite, &add);
-    
-    //Add to original frame
-    add.setUniform("bloom", tempTexture.getTexture());
-    add.setUniform("source", sourceTexture);
-    tempTexture.draw(sprite, &add);
-    sf::Sprite result(tempTexture.getTexture());
-    GameWindow->draw(result);
-    xRenderTexture->clear();
-    xRenderTexture->setActive(false);   
+        std::cout << "SHADERS: PostProcess.cfg - SUCCESS" << "\n";
+    }
+
+    buildStages();
+    setResolution(resolution);
+    std::cout << "SHADERS: " << _passes.size() << " passes fused into " << _stages.size() << " full-screen draws" << "\n";
+
+    // The intro draws without post-processing until the programs are built
+    _compiler = std::thread(&Shaders::compileStages, this);
+}
+
+Shaders::~Shaders()
+{
+    if (_compiler.joinable())
+    {
+        _compiler.join();
+    }
+}
+
+bool Shaders::isReady() const
+{
+    return _ready.load(std::memory_order_acquire);
+}
+
+bool Shaders::hasFailed() const
+{
+    return _failed.load(std::memory_order_acquire);
+}
+
+CpuBloom::Parameters Shaders::getBloomParameters() const
+{
+    // Stages missing from the graph stay neutral
+    CpuBloom::Parameters parameters;
+    parameters.strength = 0.0f;
+    parameters.exposure = 0.0f;
+    parameters.intensity = 0.0f;
+    parameters.vignette = 0.0f;
+    for (const PassDesc& pass : _passes)
+    {
+        // Unset parameters take the op's default, as in the shaders
+        auto param = [&pass](const std::string& name) {
+            auto it = pass.params.find(name);
+            if (it != pass.params.end())
+            {
+                return it->second;
+            }
+            for (const auto& fallback : findOp(pass.type)->params)
+            {
+                if (fallback.first == name)
+                {
+                    return fallback.second;
+                }
+            }
+            return 0.0f;
+        };
+        if (pass.type == "blurX" || pass.type == "blurY")
+        {
+            parameters.sigma = param("sigma");
+            parameters.glow = param("glow");
+        }
+        else if (pass.type == "combine")
+        {
+            parameters.strength = param("strength");
+        }
+        else if (pass.type == "tonemap")
+        {
+            parameters.exposure = param("exposure");
+        }
+        else if (pass.type == "scanline")
+        {
+            parameters.intensity = param("intensity");
+            parameters.vignette = param("vignette");
+        }
+    }
+    return parameters;
+}
+
+int Shaders::getPassCount() const
+{
+    return static_cast<int>(_stages.size());
+}
+
+bool Shaders::parseGraph(std::istream& in)
+{
+    // <type> <input>[,<input>] -> <output> [param=value ...]
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream tokens(line);
+        PassDesc pass;
+        std::string inputs;
+        std::string arrow;
+        if (!(tokens >> pass.type))
+        {
+            continue;
+        }
+        if (!(tokens >> inputs >> arrow >> pass.output) || arrow != "->")
+        {
+            std::cout << "SHADERS: Malformed pass \"" << line << "\"" << "\n";
+            return false;
+        }
+        std::istringstream inputList(inputs);
+        std::string input;
+        while (std::getline(inputList, input, ','))
+        {
+            pass.inputs.push_back(input);
+        }
+        std::string param;
+        while (tokens >> param)
+        {
+            size_t eq = param.find('=');
+            if (eq == std::string::npos)
+            {
+                std::cout << "SHADERS: Malformed parameter \"" << param << "\"" << "\n";
+                return false;
+            }
+            try
+            {
+                pass.params[param.substr(0, eq)] = std::stof(param.substr(eq + 1));
+            }
+            catch (const std::exception&)
+            {
+                std::cout << "SHADERS: Malformed parameter \"" << param << "\"" << "\n";
+                return false;
+            }
+        }
+        _passes.push_back(pass);
+    }
+    return !_passes.empty();
+}
+
+bool Shaders::validateGraph() const
+{
+    std::vector<std::string> available = { SCENE };
+    for (size_t i = 0; i < _passes.size(); i++)
+    {
+        const PassDesc& pass = _passes[i];
+        const OpInfo* op = findOp(pass.type);
+        if (!op)
+        {
+            std::cout << "SHADERS: Unknown pass type " << pass.type << "\n";
+            return false;
+        }
+        if (pass.inputs.size() != op->inputs)
+        {
+            std::cout << "SHADERS: " << pass.type << " expects " << op->inputs << " inputs" << "\n";
+            return false;
+        }
+        for (const std::string& input : pass.inputs)
+        {
+            if (std::find(available.begin(), available.end(), input) == available.end())
+            {
+                std::cout << "SHADERS: " << pass.type << " reads " << input << " before it is written" << "\n";
+                return false;
+            }
+        }
+        if (pass.output == SCENE || (pass.output == SCREEN) != (i == _passes.size() - 1))
+        {
+            std::cout << "SHADERS: only the last pass may write to screen" << "\n";
+            return false;
+        }
+        // A target is never read and written by the same draw, and each one has a single writer
+        if (std::find(pass.inputs.begin(), pass.inputs.end(), pass.output) != pass.inputs.end())
+        {
+            std::cout << "SHADERS: " << pass.type << " reads and writes " << pass.output << "\n";
+            return false;
+        }
+        if (std::find(available.begin(), available.end(), pass.output) != available.end())
+        {
+            std::cout << "SHADERS: " << pass.type << " writes " << pass.output << " again" << "\n";
+            return false;
+        }
+        available.push_back(pass.output);
+    }
+    return true;
+}
+
+bool Shaders::isPointWise(const std::string& type) const
+{
+    const OpInfo* op = findOp(type);
+    return op && op->pointWise;
+}
+
+int Shaders::consumerCount(const std::string& resource) const
+{
+    int count = 0;
+    for (const PassDesc& pass : _passes)
+    {
+        count += static_cast<int>(std::count(pass.inputs.begin(), pass.inputs.end(), resource));
+    }
+    return count;
+}
+
+void Shaders::buildStages()
+{
+    size_t i = 0;
+    while (i < _passes.size())
+    {
+        const PassDesc& pass = _passes[i];
+        const OpInfo* op = findOp(pass.type);
+        Stage stage;
+        stage.shader = std::make_unique<sf::Shader>();
+
+        if (!op->pointWise)
+        {
+            // Blur passes keep their own shader file
+            if (!Assets::getText(op->file, stage.source))
+            {
+                std::cout << "SHADERS: Failed to load " << op->file << "\n";
+                _failed.store(true, std::memory_order_release);
+            }
+            auto param = [&](const std::string& name, float fallback) {
+                auto it = pass.params.find(name);
+                return it != pass.params.end() ? it->second : fallback;
+            };
+            stage.sigma = param("sigma", 5.0f);
+            stage.params.emplace_back("glowMultiplier", param("glow", 1.0f));
+            if (_kernelSigmas > 0.0f)
+            {
+                // Weights past a few sigma are invisible, stop sampling there
+                int kernel = std::clamp(static_cast<int>(std::ceil(stage.sigma * _kernelSigmas)), 1, 50);
+                stage.source = "#define KERNEL_SIZE " + std::to_string(kernel) + "\n" + stage.source;
+            }
+            stage.samplers.push_back(pass.inputs.front());
+            stage.samplerUniforms.push_back("sourceTexture");
+            stage.output = pass.output;
+            stage.type = pass.type;
+            stage.zone = PROFILE_REGISTER("PostProcess " + pass.type);
+            _stages.push_back(std::move(stage));
+            i++;
+            continue;
+        }
+
+        // Collect a run of point-wise passes where each feeds only the next one
+        std::vector<const PassDesc*> group = { &pass };
+        while (i + 1 < _passes.size()
+            && isPointWise(_passes[i + 1].type)
+            && _passes[i].output != SCREEN
+            && consumerCount(_passes[i].output) == 1
+            && std::count(_passes[i + 1].inputs.begin(), _passes[i + 1].inputs.end(), _passes[i].output) == 1)
+        {
+            i++;
+            group.push_back(&_passes[i]);
+        }
+
+        stage.source = generateFusedSource(group, stage.samplers);
+        for (size_t s = 0; s < stage.samplers.size(); s++)
+        {
+            stage.samplerUniforms.push_back("tex" + std::to_string(s));
+        }
+        for (size_t p = 0; p < group.size(); p++)
+        {
+            for (const auto& param : findOp(group[p]->type)->params)
+            {
+                auto it = group[p]->params.find(param.first);
+                float value = it != group[p]->params.end() ? it->second : param.second;
+                stage.params.emplace_back("p" + std::to_string(p) + "_" + param.first, value);
+            }
+        }
+        stage.output = group.back()->output;
+        stage.type = "fused";
+        stage.zone = PROFILE_REGISTER("PostProcess fused");
+        stage.sigma = 0.0f;
+        _stages.push_back(std::move(stage));
+        i++;
+    }
+}
+
+void Shaders::compileStages()
+{
+    // Programs are shared between SFML's contexts, this thread only needs one of its own
+    sf::Context context;
+#ifdef RSS_PROFILING
+    Profiler::setThreadName("ShaderCompiler");
+#endif
+    sf::Clock clock;
+    {
+        PROFILE_SCOPE("ShaderCompile");
+        for (Stage& stage : _stages)
+        {
+            if (!stage.shader->loadFromMemory(stage.source, sf::Shader::Fragment))
+            {
+                std::cout << "SHADERS: Failed to compile " << stage.type << " pass" << "\n" << stage.source << "\n";
+                _failed.store(true, std::memory_order_release);
+            }
+            for (const auto& param : stage.params)
+            {
+                stage.shader->setUniform(param.first, param.second);
+            }
+        }
+        std::lock_guard<std::mutex> lock(_uniformMutex);
+        applyResolutionUniforms();
+        // Finish before publishing so the window's context sees complete programs
+        glFinish();
+        _ready.store(true, std::memory_order_release);
+    }
+    std::cout << "SHADERS: " << _stages.size() << " programs compiled in the background in " << clock.getElapsedTime().asMilliseconds() << " ms" << "\n";
+}
+
+std::string Shaders::loadSnippet(const std::string& type)
+{
+    auto cached = _snippets.find(type);
+    if (cached != _snippets.end())
+    {
+        return cached->second;
+    }
+    const OpInfo* op = findOp(type);
+    if (!Assets::getText(op->file, _snippets[type]))
+    {
+        std::cout << "SHADERS: Failed to load " << op->file << "\n";
+        _failed.store(true, std::memory_order_release);
+    }
+    return _snippets[type];
+}
+
+std::string Shaders::generateFusedSource(const std::vector<const PassDesc*>& group, std::vector<std::string>& samplers)
+{
+    std::ostringstream header;
+    std::ostringstream functions;
+    std::ostringstream body;
+    std::vector<std::string> definedTypes;
+
+    header << "uniform vec2 resolution;\n";
+    body << "void main()\n{\n    vec2 uv = gl_TexCoord[0].xy;\n";
+
+    for (size_t p = 0; p < group.size(); p++)
+    {
+        const PassDesc& pass = *group[p];
+        const OpInfo* op = findOp(pass.type);
+        if (std::find(definedTypes.begin(), definedTypes.end(), pass.type) == definedTypes.end())
+        {
+            functions << loadSnippet(pass.type) << "\n";
+            definedTypes.push_back(pass.type);
+        }
+
+        body << "    vec4 c" << p << " = " << pass.type << "(";
+        for (const std::string& input : pass.inputs)
+        {
+            if (p > 0 && input == group[p - 1]->output)
+            {
+                // Fused: read the previous result from a register instead of a texture
+                body << "c" << (p - 1) << ", ";
+                continue;
+            }
+            auto it = std::find(samplers.begin(), samplers.end(), input);
+            size_t index = it - samplers.begin();
+            if (it == samplers.end())
+            {
+                samplers.push_back(input);
+                header << "uniform sampler2D tex" << index << ";\n";
+            }
+            body << "texture2D(tex" << index << ", uv), ";
+        }
+        body << "uv";
+        for (const auto& param : op->params)
+        {
+            header << "uniform float p" << p << "_" << param.first << ";\n";
+            body << ", p" << p << "_" << param.first;
+        }
+        body << ");\n";
+    }
+    body << "    gl_FragColor = c" << (group.size() - 1) << ";\n}\n";
+
+    return header.str() + functions.str() + body.str();
+}
+
+void Shaders::setResolution(sf::Vector2u resolution)
+{
+    if (resolution == _resolution)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_uniformMutex);
+    _resolution = resolution;
+    createTargets();
+    // Until the compiler thread is done it applies these itself
+    if (_ready.load(std::memory_order_acquire))
+    {
+        applyResolutionUniforms();
+    }
+}
+
+void Shaders::applyResolutionUniforms()
+{
+    // Blur radius is in texels, scale it so the glow keeps its on-screen size
+    float scale = static_cast<float>(_resolution.x) / _windowSize.x;
+    for (Stage& stage : _stages)
+    {
+        if (stage.type == "blurX")
+        {
+            stage.shader->setUniform("sigma", stage.sigma * scale);
+            stage.shader->setUniform("width", static_cast<float>(_resolution.x));
+        }
+        else if (stage.type == "blurY")
+        {
+            stage.shader->setUniform("sigma", stage.sigma * scale);
+            stage.shader->setUniform("height", static_cast<float>(_resolution.y));
+        }
+        else
+        {
+            sf::Vector2u output = stage.output == SCREEN ? _windowSize : _resolution;
+            stage.shader->setUniform("resolution", sf::Glsl::Vec2(static_cast<float>(output.x), static_cast<float>(output.y)));
+        }
+    }
+}
+
+void Shaders::createTargets()
+{
+    _targets.clear();
+    for (const Stage& stage : _stages)
+    {
+        if (stage.output == SCREEN)
+        {
+            continue;
+        }
+        auto target = std::make_unique<sf::RenderTexture>();
+        if (!target->create(_resolution.x, _resolution.y))
+        {
+            std::cout << "SHADERS: failed to create " << stage.output << " target" << "\n";
+            _failed.store(true, std::memory_order_release);
+        }
+        target->setSmooth(true);
+        _targets[stage.output] = std::move(target);
+    }
+}
+
+const sf::Texture& Shaders::resolveTexture(const std::string& name, const sf::RenderTexture& scene) const
+{
+    if (name == SCENE)
+    {
+        return scene.getTexture();
+    }
+    return _targets.at(name)->getTexture();
+}
+
+void Shaders::applyPostProcess(std::shared_ptr<sf::RenderTexture> sceneTexture, sf::RenderTarget& output)
+{
+    sceneTexture->display();
+
+    for (Stage& stage : _stages)
+    {
+        PROFILE_ZONE(stage.zone);
+
+        // Bind inputs
+        for (size_t s = 0; s < stage.samplers.size(); s++)
+        {
+            stage.shader->setUniform(stage.samplerUniforms[s], resolveTexture(stage.samplers[s], *sceneTexture));
+        }
+
+        sf::Sprite sprite(resolveTexture(stage.samplers.front(), *sceneTexture));
+        PROFILE_COUNT(Counters::BloomPasses, 1);
+        PROFILE_COUNT(Counters::TargetSwitches, 1);
+        PROFILE_COUNT(Counters::DrawCalls, 1);
+        PROFILE_COUNT(Counters::Vertices, 4);
+        if (stage.output == SCREEN)
+        {
+            // Single upscale from the internal resolution to the window
+            sprite.setScale(static_cast<float>(output.getSize().x) / _resolution.x, static_cast<float>(output.getSize().y) / _resolution.y);
+            output.draw(sprite, stage.shader.get());
+        }
+        else
+        {
+            sf::RenderTexture& target = *_targets[stage.output];
+            target.clear(sf::Color::Black);
+            target.draw(sprite, stage.shader.get());
+            target.display();
+        }
+    }
 }
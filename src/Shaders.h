@@ -1,13 +1,73 @@
 #pragma once
 #include "SFML/Graphics.hpp"
-class Shaders 
+#include "CpuBloom.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Post-processing graph. Passes are declared in Shaders/PostProcess.cfg,
+// adjacent point-wise passes are fused into a single generated shader.
+// Intermediate targets run at the scene resolution, the last pass upscales to the window.
+// Programs compile on a background thread, isReady() turns true once all of them have.
+// hasFailed() turns true when any file, program or target could not be made.
+class Shaders
 {
 public:
-	Shaders(sf::RenderWindow* window);
-	void applyBloom(std::shared_ptr<sf::RenderTexture> renderTexture);
+	Shaders(sf::RenderWindow* window, sf::Vector2u resolution, const std::string& bloomQuality);
+	~Shaders();
+	bool isReady() const;
+	bool hasFailed() const;
+	// The graph's blur, combine, tonemap and scanline settings for the CPU fallback
+	CpuBloom::Parameters getBloomParameters() const;
+	// The last pass draws into output, the window or a capture's texture of the same size
+	void applyPostProcess(std::shared_ptr<sf::RenderTexture> sceneTexture, sf::RenderTarget& output);
+	void setResolution(sf::Vector2u resolution);
+	int getPassCount() const;
 private:
-	std::shared_ptr<sf::RenderWindow> GameWindow;
-	sf::Shader bloomX;
-	sf::Shader bloomY;
-	sf::Shader add;
-};
\ No newline at end of file
+	struct PassDesc
+	{
+		std::string type;
+		std::vector<std::string> inputs;
+		std::string output;
+		std::map<std::string, float> params;
+	};
+	struct Stage
+	{
+		std::unique_ptr<sf::Shader> shader;
+		std::string source;
+		std::vector<std::pair<std::string, float>> params;
+		std::vector<std::string> samplers;
+		std::vector<std::string> samplerUniforms;
+		std::string output;
+		std::string type;
+		float sigma;
+		int zone;
+	};
+	sf::RenderWindow* GameWindow;
+	sf::Vector2u _windowSize;
+	sf::Vector2u _resolution;
+	float _kernelSigmas;
+	std::vector<PassDesc> _passes;
+	std::vector<Stage> _stages;
+	std::map<std::string, std::unique_ptr<sf::RenderTexture>> _targets;
+	std::map<std::string, std::string> _snippets;
+	std::atomic<bool> _ready;
+	std::atomic<bool> _failed;
+	std::mutex _uniformMutex;
+	std::thread _compiler;
+	bool parseGraph(std::istream& in);
+	bool validateGraph() const;
+	void buildStages();
+	void compileStages();
+	void applyResolutionUniforms();
+	void createTargets();
+	bool isPointWise(const std::string& type) const;
+	int consumerCount(const std::string& resource) const;
+	std::string loadSnippet(const std::string& type);
+	std::string generateFusedSource(const std::vector<const PassDesc*>& group, std::vector<std::string>& samplers);
+	const sf::Texture& resolveTexture(const std::string& name, const sf::RenderTexture& scene) const;
+};
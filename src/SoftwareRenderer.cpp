@@ -0,0 +1,323 @@
+#include "SoftwareRenderer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+	// Widest span a disc covers on one row, per thread
+	thread_local std::vector<float> spanCoverage;
+
+	inline sf::Uint8 blend(sf::Uint8 source, sf::Uint8 destination, float alpha)
+	{
+		return static_cast<sf::Uint8>(source * alpha + destination * (1.0f - alpha) + 0.5f);
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(sf::Vector2u size, int threads) :
+	_size(size),
+	_pool(threads),
+	_clearColor(sf::Color::Black),
+	_scale(1.0f),
+	_pixels(static_cast<size_t>(size.x) * size.y * 4, 0),
+	_bands((size.y + BAND_ROWS - 1) / BAND_ROWS)
+{
+	setView(sf::View(sf::FloatRect(0.0f, 0.0f, static_cast<float>(size.x), static_cast<float>(size.y))));
+}
+
+sf::Vector2u SoftwareRenderer::getSize() const
+{
+	return _size;
+}
+
+void SoftwareRenderer::clear(sf::Color color)
+{
+	// The fill happens band by band in render, next to the drawing
+	_clearColor = color;
+	_discs.clear();
+	_glyphs.clear();
+	_order.clear();
+}
+
+void SoftwareRenderer::setView(const sf::View& view)
+{
+	// View space to normalised device coordinates, then to pixels with y down
+	float halfWidth = 0.5f * _size.x;
+	float halfHeight = 0.5f * _size.y;
+	_transform = sf::Transform(halfWidth, 0.0f, halfWidth, 0.0f, -halfHeight, halfHeight, 0.0f, 0.0f, 1.0f);
+	_transform.combine(view.getTransform());
+	_scale = _size.x / view.getSize().x;
+}
+
+void SoftwareRenderer::draw(const TextBatch& texts)
+{
+	for (size_t p = 0; p < texts.getPageCount(); p++)
+	{
+		const std::vector<sf::Vertex>& vertices = texts.getPageVertices(p);
+		if (vertices.empty())
+		{
+			continue;
+		}
+		const Atlas& atlas = getAtlas(texts.getPageTexture(p), texts.getPageRevision(p));
+		// Six vertices per glyph, the first is the top left corner and the last the bottom right
+		for (size_t v = 0; v + 5 < vertices.size(); v += 6)
+		{
+			sf::Vector2f topLeft = _transform.transformPoint(vertices[v].position);
+			sf::Vector2f bottomRight = _transform.transformPoint(vertices[v + 5].position);
+			Glyph glyph;
+			glyph.left = topLeft.x;
+			glyph.top = topLeft.y;
+			glyph.right = bottomRight.x;
+			glyph.bottom = bottomRight.y;
+			glyph.u1 = vertices[v].texCoords.x;
+			glyph.v1 = vertices[v].texCoords.y;
+			glyph.u2 = vertices[v + 5].texCoords.x;
+			glyph.v2 = vertices[v + 5].texCoords.y;
+			glyph.color = vertices[v].color;
+			glyph.atlas = &atlas;
+			_order.push_back(static_cast<std::uint32_t>(_glyphs.size()) | GLYPH_BIT);
+			_glyphs.push_back(glyph);
+		}
+	}
+}
+
+void SoftwareRenderer::draw(const CircleBatch& circles)
+{
+	const std::vector<sf::Vector2f>& positions = circles.getPositions();
+	const std::vector<float>& radii = circles.getRadii();
+	const std::vector<sf::Color>& colors = circles.getColors();
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		sf::Vector2f center = _transform.transformPoint(positions[i]);
+		_order.push_back(static_cast<std::uint32_t>(_discs.size()));
+		_discs.push_back({ center.x, center.y, radii[i] * _scale, colors[i] });
+	}
+}
+
+void SoftwareRenderer::render()
+{
+	PROFILE_SCOPE("SoftwareRender");
+	for (std::vector<std::uint32_t>& band : _bands)
+	{
+		band.clear();
+	}
+	for (std::uint32_t item : _order)
+	{
+		if (item & GLYPH_BIT)
+		{
+			const Glyph& glyph = _glyphs[item & ~GLYPH_BIT];
+			binBands(glyph.top, glyph.bottom, item);
+		}
+		else
+		{
+			const Disc& disc = _discs[item];
+			binBands(disc.y - disc.radius - 1.0f, disc.y + disc.radius + 1.0f, item);
+		}
+	}
+	auto renderBands = [&](int begin, int end) {
+		for (int band = begin; band < end; band++)
+		{
+			renderBand(band);
+		}
+	};
+	_pool.parallelFor(static_cast<int>(_bands.size()), 1, renderBands);
+}
+
+void SoftwareRenderer::binBands(float top, float bottom, std::uint32_t item)
+{
+	if (bottom < 0.0f)
+	{
+		return;
+	}
+	int first = std::max(0, static_cast<int>(std::floor(top)) / BAND_ROWS);
+	int last = std::min(static_cast<int>(_bands.size()) - 1, static_cast<int>(std::floor(bottom)) / BAND_ROWS);
+	for (int band = first; band <= last; band++)
+	{
+		_bands[band].push_back(item);
+	}
+}
+
+void SoftwareRenderer::renderBand(int band)
+{
+	int rowBegin = band * BAND_ROWS;
+	int rowEnd = std::min(static_cast<int>(_size.y), rowBegin + BAND_ROWS);
+	sf::Uint8* row = &_pixels[static_cast<size_t>(rowBegin) * _size.x * 4];
+	size_t bytes = static_cast<size_t>(rowEnd - rowBegin) * _size.x * 4;
+	for (size_t i = 0; i < bytes; i += 4)
+	{
+		row[i] = _clearColor.r;
+		row[i + 1] = _clearColor.g;
+		row[i + 2] = _clearColor.b;
+		row[i + 3] = _clearColor.a;
+	}
+	for (std::uint32_t item : _bands[band])
+	{
+		if (item & GLYPH_BIT)
+		{
+			rasterGlyph(_glyphs[item & ~GLYPH_BIT], rowBegin, rowEnd);
+		}
+		else
+		{
+			rasterDisc(_discs[item], rowBegin, rowEnd);
+		}
+	}
+}
+
+void SoftwareRenderer::rasterDisc(const Disc& disc, int rowBegin, int rowEnd)
+{
+	// Coverage is the signed distance to the edge clamped to one pixel, sampled at pixel centres
+	float outer = disc.radius + 0.5f;
+	int y0 = std::max(rowBegin, static_cast<int>(std::floor(disc.y - outer)));
+	int y1 = std::min(rowEnd, static_cast<int>(std::ceil(disc.y + outer)));
+	float alpha = disc.color.a / 255.0f;
+	for (int y = y0; y < y1; y++)
+	{
+		float dy = y + 0.5f - disc.y;
+		float reach = outer * outer - dy * dy;
+		if (reach <= 0.0f)
+		{
+			continue;
+		}
+		float half = std::sqrt(reach);
+		int x0 = std::max(0, static_cast<int>(std::floor(disc.x - half)));
+		int x1 = std::min(static_cast<int>(_size.x), static_cast<int>(std::ceil(disc.x + half)));
+		int span = x1 - x0;
+		if (span <= 0)
+		{
+			continue;
+		}
+		if (static_cast<int>(spanCoverage.size()) < span)
+		{
+			spanCoverage.resize(span);
+		}
+		// Independent lanes, no writes to the framebuffer, so this loop vectorises
+		float* coverage = spanCoverage.data();
+		float dy2 = dy * dy;
+		float startX = x0 + 0.5f - disc.x;
+		for (int k = 0; k < span; k++)
+		{
+			float dx = startX + k;
+			float c = outer - std::sqrt(dx * dx + dy2);
+			coverage[k] = std::min(std::max(c, 0.0f), 1.0f) * alpha;
+		}
+		sf::Uint8* pixel = &_pixels[(static_cast<size_t>(y) * _size.x + x0) * 4];
+		for (int k = 0; k < span; k++, pixel += 4)
+		{
+			pixel[0] = blend(disc.color.r, pixel[0], coverage[k]);
+			pixel[1] = blend(disc.color.g, pixel[1], coverage[k]);
+			pixel[2] = blend(disc.color.b, pixel[2], coverage[k]);
+			pixel[3] = blend(255, pixel[3], coverage[k]);
+		}
+	}
+}
+
+void SoftwareRenderer::rasterGlyph(const Glyph& glyph, int rowBegin, int rowEnd)
+{
+	// Pixel centres map linearly onto the glyph's atlas rectangle, sampled bilinearly
+	float width = glyph.right - glyph.left;
+	float height = glyph.bottom - glyph.top;
+	if (width <= 0.0f || height <= 0.0f || glyph.atlas->alpha.empty())
+	{
+		return;
+	}
+	const Atlas& atlas = *glyph.atlas;
+	int x0 = std::max(0, static_cast<int>(std::floor(glyph.left)));
+	int x1 = std::min(static_cast<int>(_size.x), static_cast<int>(std::ceil(glyph.right)));
+	int y0 = std::max(rowBegin, static_cast<int>(std::floor(glyph.top)));
+	int y1 = std::min(rowEnd, static_cast<int>(std::ceil(glyph.bottom)));
+	float uScale = (glyph.u2 - glyph.u1) / width;
+	float vScale = (glyph.v2 - glyph.v1) / height;
+	float alpha = glyph.color.a / 255.0f / 255.0f;
+	int maxU = static_cast<int>(atlas.width) - 1;
+	int maxV = static_cast<int>(atlas.height) - 1;
+	for (int y = y0; y < y1; y++)
+	{
+		float v = glyph.v1 + (y + 0.5f - glyph.top) * vScale - 0.5f;
+		int v0 = std::clamp(static_cast<int>(std::floor(v)), 0, maxV);
+		int v1 = std::min(v0 + 1, maxV);
+		float fv = std::clamp(v - v0, 0.0f, 1.0f);
+		const sf::Uint8* top = &atlas.alpha[static_cast<size_t>(v0) * atlas.width];
+		const sf::Uint8* bottom = &atlas.alpha[static_cast<size_t>(v1) * atlas.width];
+		sf::Uint8* pixel = &_pixels[(static_cast<size_t>(y) * _size.x + x0) * 4];
+		for (int x = x0; x < x1; x++, pixel += 4)
+		{
+			float u = glyph.u1 + (x + 0.5f - glyph.left) * uScale - 0.5f;
+			int u0 = std::clamp(static_cast<int>(std::floor(u)), 0, maxU);
+			int u1 = std::min(u0 + 1, maxU);
+			float fu = std::clamp(u - u0, 0.0f, 1.0f);
+			float sample = (top[u0] * (1.0f - fu) + top[u1] * fu) * (1.0f - fv) + (bottom[u0] * (1.0f - fu) + bottom[u1] * fu) * fv;
+			float coverage = sample * alpha;
+			if (coverage <= 0.0f)
+			{
+				continue;
+			}
+			pixel[0] = blend(glyph.color.r, pixel[0], coverage);
+			pixel[1] = blend(glyph.color.g, pixel[1], coverage);
+			pixel[2] = blend(glyph.color.b, pixel[2], coverage);
+			pixel[3] = blend(255, pixel[3], coverage);
+		}
+	}
+}
+
+const SoftwareRenderer::Atlas& SoftwareRenderer::getAtlas(const sf::Texture* texture, unsigned int revision)
+{
+	// The atlas is read back once and again only when its page gained texts or the texture grew
+	Atlas& atlas = _atlases[texture];
+	sf::Vector2u size = texture->getSize();
+	if (atlas.alpha.empty() || atlas.revision != revision || atlas.width != size.x || atlas.height != size.y)
+	{
+		sf::Image image = texture->copyToImage();
+		atlas.revision = revision;
+		atlas.width = image.getSize().x;
+		atlas.height = image.getSize().y;
+		atlas.alpha.resize(static_cast<size_t>(atlas.width) * atlas.height);
+		const sf::Uint8* pixels = image.getPixelsPtr();
+		for (size_t i = 0; i < atlas.alpha.size(); i++)
+		{
+			atlas.alpha[i] = pixels[i * 4 + 3];
+		}
+	}
+	return atlas;
+}
+
+const std::vector<sf::Uint8>& SoftwareRenderer::getPixels() const
+{
+	return _pixels;
+}
+
+std::vector<sf::Uint8>& SoftwareRenderer::getPixels()
+{
+	return _pixels;
+}
+
+std::uint64_t SoftwareRenderer::getHash() const
+{
+	std::uint64_t hash = 1469598103934665603ull;
+	for (sf::Uint8 byte : _pixels)
+	{
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+	return hash;
+}
+
+bool SoftwareRenderer::saveToFile(const std::string& path) const
+{
+	if (path.size() > 4 && path.compare(path.size() - 4, 4, ".ppm") == 0)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		file << "P6\n" << _size.x << " " << _size.y << "\n255\n";
+		for (size_t i = 0; i < _pixels.size(); i += 4)
+		{
+			file.write(reinterpret_cast<const char*>(&_pixels[i]), 3);
+		}
+		return static_cast<bool>(file);
+	}
+	sf::Image image;
+	image.create(_size.x, _size.y, _pixels.data());
+	return image.saveToFile(path);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include "CircleBatch.h"
+#include "TextBatch.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// CPU rasteriser for machines without a GPU. Draws the same batches the SFML
+// path draws into an RGBA framebuffer: circles as exact discs with a one pixel
+// anti-aliased edge, glyph quads sampled from a CPU copy of the font atlas.
+// draw only records, render bins everything into fixed bands of rows and
+// each band is rasterised by one pool task in submission order, so the image
+// is the same for any thread count.
+class SoftwareRenderer
+{
+public:
+	// threads counts the caller, 0 = one per core
+	SoftwareRenderer(sf::Vector2u size, int threads);
+	sf::Vector2u getSize() const;
+	void clear(sf::Color color);
+	void setView(const sf::View& view);
+	void draw(const TextBatch& texts);
+	void draw(const CircleBatch& circles);
+	void render();
+	const std::vector<sf::Uint8>& getPixels() const;
+	// For post-processing in place after render
+	std::vector<sf::Uint8>& getPixels();
+	// FNV-1a of the pixels, for golden image checks
+	std::uint64_t getHash() const;
+	// .ppm is written directly, anything else goes through sf::Image
+	bool saveToFile(const std::string& path) const;
+private:
+	static const int BAND_ROWS = 32;
+	// Set on band items that index _glyphs instead of _discs
+	static const std::uint32_t GLYPH_BIT = 0x80000000u;
+	struct Disc
+	{
+		float x;
+		float y;
+		float radius;
+		sf::Color color;
+	};
+	struct Atlas
+	{
+		unsigned int revision;
+		unsigned int width;
+		unsigned int height;
+		std::vector<sf::Uint8> alpha;
+	};
+	struct Glyph
+	{
+		float left;
+		float top;
+		float right;
+		float bottom;
+		float u1;
+		float v1;
+		float u2;
+		float v2;
+		sf::Color color;
+		const Atlas* atlas;
+	};
+	sf::Vector2u _size;
+	ThreadPool _pool;
+	sf::Color _clearColor;
+	sf::Transform _transform;
+	float _scale;
+	std::vector<sf::Uint8> _pixels;
+	std::vector<Disc> _discs;
+	std::vector<Glyph> _glyphs;
+	std::vector<std::uint32_t> _order;
+	std::vector<std::vector<std::uint32_t>> _bands;
+	std::map<const sf::Texture*, Atlas> _atlases;
+	const Atlas& getAtlas(const sf::Texture* texture, unsigned int revision);
+	void binBands(float top, float bottom, std::uint32_t item);
+	void renderBand(int band);
+	void rasterDisc(const Disc& disc, int rowBegin, int rowEnd);
+	void rasterGlyph(const Glyph& glyph, int rowBegin, int rowEnd);
+};
@@ -0,0 +1,210 @@
+#include "SolverDiff.h"
+#include "GameManager.h"
+#include "Config.h"
+#include "World.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	const SolverDiff::Backend REFERENCE = { "none", "reference" };
+	const SolverDiff::Backend ALTERNATIVES[] =
+	{
+		{ "grid", "reference" },
+		{ "verlet", "reference" },
+		{ "grid", "batched" },
+		{ "verlet", "batched" },
+		{ "grid", "parallel" },
+		{ "verlet", "parallel" }
+	};
+	const float FIXED_DT = 1.0f / 144.0f;
+	const sf::Vector2u WORLD_SIZE(1920, 1080);
+	// Tolerances. Contacts: share of resolved pairs found by only one side,
+	// the mean over the run and the worst of the first DRIFT_FRAMES frames.
+	// Momentum and energy: worst frame, relative to the reference's mean.
+	// Drift: RMS distance in meters, worst of the first DRIFT_FRAMES frames.
+	// The intro drops its circles overlapping, so the order pairs are solved
+	// in changes the trajectories within a few frames: every backend, even
+	// grid/reference with the reference's own solver, first differs at frame
+	// 4 to 8. The bounds sit above what seeds 1-5 over 1000 frames gave for
+	// all six backends, observed ranges are next to each. They catch a solver
+	// that stops working, not rounding: with solve skipped, momentum was off
+	// by 90% and energy by 46%.
+	const float CONTACT_TOLERANCE = 0.85f;         // 69.9% to 75.1%
+	// A few contacts per early frame, one differing pair is a large share
+	const float EARLY_CONTACT_TOLERANCE = 1.0f;    // 65.6% to 100%
+	const float MOMENTUM_TOLERANCE = 0.25f;        // 6.0% to 15.3%
+	const float ENERGY_TOLERANCE = 0.30f;          // 6.5% to 19.4%
+	const float DRIFT_TOLERANCE = 2.5f;            // 1.23 m to 1.86 m
+	const int DRIFT_FRAMES = 30;
+}
+
+SolverDiff::SolverDiff(std::shared_ptr<sf::Font> font, std::uint32_t seed, int frames) :
+	_font(font),
+	_seed(seed),
+	_frames(frames)
+{
+}
+
+int SolverDiff::run()
+{
+	std::cout << "SOLVERDIFF: " << _frames << " frames, seed " << _seed << ", reference " << getName(REFERENCE) << "\n";
+	Trace reference;
+	if (!record(REFERENCE, reference))
+	{
+		return -1;
+	}
+	int failed = 0;
+	for (const Backend& backend : ALTERNATIVES)
+	{
+		Trace trace;
+		if (!record(backend, trace) || !compare(backend, reference, trace))
+		{
+			failed++;
+		}
+	}
+	std::cout << "SOLVERDIFF: " << (failed == 0 ? "all backends within tolerance" : std::to_string(failed) + " backends FAILED") << "\n";
+	return failed;
+}
+
+bool SolverDiff::record(const Backend& backend, Trace& trace) const
+{
+	if (!Config::override("physics.broadPhase", backend.broadPhase) || !Config::override("physics.solver", backend.solver))
+	{
+		return false;
+	}
+	World world(0, WORLD_SIZE, _seed);
+	World::setCurrent(&world);
+	trace.frames.resize(_frames);
+	trace.seconds = 0.0f;
+	{
+		GameManager game(nullptr, _font);
+		sf::Clock clock;
+		for (Frame& frame : trace.frames)
+		{
+			// Only the step is timed, the sampling below is the harness's own cost
+			game.setContactLog(&frame.contacts);
+			clock.restart();
+			game.step(FIXED_DT);
+			trace.seconds += clock.getElapsedTime().asSeconds();
+			game.setContactLog(nullptr);
+
+			// Pairs are kept as (lower, higher) and sorted, so sets compare with a merge
+			for (std::pair<int, int>& contact : frame.contacts)
+			{
+				if (contact.first > contact.second)
+				{
+					std::swap(contact.first, contact.second);
+				}
+			}
+			std::sort(frame.contacts.begin(), frame.contacts.end());
+			frame.momentum = sf::Vector2f(0.0f, 0.0f);
+			frame.momentumScale = 0.0f;
+			frame.energy = 0.0f;
+			frame.positions.clear();
+			for (const auto& circle : game.getCircles())
+			{
+				sf::Vector2f velocity = circle->getVelocity();
+				float mass = circle->getMass();
+				float speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+				frame.momentum += mass * velocity;
+				frame.momentumScale += mass * speed;
+				frame.energy += 0.5f * mass * speed * speed;
+				frame.positions.push_back(circle->getPositionInMetersFromPixels());
+			}
+		}
+	}
+	World::setCurrent(nullptr);
+	return true;
+}
+
+bool SolverDiff::compare(const Backend& backend, const Trace& reference, const Trace& trace) const
+{
+	// Normalised by the reference's means, so a world coming to rest doesn't blow up the ratios
+	double meanMomentum = 0.0;
+	double meanEnergy = 0.0;
+	for (const Frame& frame : reference.frames)
+	{
+		meanMomentum += frame.momentumScale;
+		meanEnergy += frame.energy;
+	}
+	meanMomentum = std::max(meanMomentum / _frames, 1e-6);
+	meanEnergy = std::max(meanEnergy / _frames, 1e-6);
+
+	double contactMismatch = 0.0;
+	float earlyContactMismatch = 0.0f;
+	int firstContactDiff = -1;
+	float momentumError = 0.0f;
+	float energyError = 0.0f;
+	float earlyDrift = 0.0f;
+	float finalDrift = 0.0f;
+	int firstCountDiff = -1;
+	std::vector<std::pair<int, int>> difference;
+	for (int f = 0; f < _frames; f++)
+	{
+		const Frame& expected = reference.frames[f];
+		const Frame& actual = trace.frames[f];
+
+		difference.clear();
+		std::set_symmetric_difference(expected.contacts.begin(), expected.contacts.end(), actual.contacts.begin(), actual.contacts.end(), std::back_inserter(difference));
+		size_t total = std::max(expected.contacts.size(), actual.contacts.size());
+		if (!difference.empty() && firstContactDiff < 0)
+		{
+			firstContactDiff = f;
+		}
+		double mismatch = total > 0 ? static_cast<double>(difference.size()) / (2.0 * total) : 0.0;
+		contactMismatch += mismatch;
+		if (f < DRIFT_FRAMES)
+		{
+			earlyContactMismatch = std::max(earlyContactMismatch, static_cast<float>(mismatch));
+		}
+
+		sf::Vector2f momentumDelta = actual.momentum - expected.momentum;
+		momentumError = std::max(momentumError, static_cast<float>(std::sqrt(momentumDelta.x * momentumDelta.x + momentumDelta.y * momentumDelta.y) / meanMomentum));
+		energyError = std::max(energyError, static_cast<float>(std::abs(actual.energy - expected.energy) / meanEnergy));
+
+		// Index-wise drift needs the same circles on both sides
+		if (expected.positions.size() != actual.positions.size())
+		{
+			if (firstCountDiff < 0)
+			{
+				firstCountDiff = f;
+			}
+			continue;
+		}
+		double squared = 0.0;
+		for (size_t i = 0; i < expected.positions.size(); i++)
+		{
+			sf::Vector2f delta = actual.positions[i] - expected.positions[i];
+			squared += delta.x * delta.x + delta.y * delta.y;
+		}
+		float drift = expected.positions.empty() ? 0.0f : static_cast<float>(std::sqrt(squared / expected.positions.size()));
+		if (f < DRIFT_FRAMES)
+		{
+			earlyDrift = std::max(earlyDrift, drift);
+		}
+		finalDrift = drift;
+	}
+	contactMismatch /= _frames;
+
+	bool passed = contactMismatch <= CONTACT_TOLERANCE && earlyContactMismatch <= EARLY_CONTACT_TOLERANCE && momentumError <= MOMENTUM_TOLERANCE && energyError <= ENERGY_TOLERANCE
+		&& earlyDrift <= DRIFT_TOLERANCE && firstCountDiff < 0;
+	std::cout << "SOLVERDIFF: " << getName(backend) << (passed ? " PASS" : " FAIL") << ", "
+		<< reference.seconds / std::max(trace.seconds, 1e-6f) << "x the reference speed (" << trace.seconds * 1000.0f << " ms vs " << reference.seconds * 1000.0f << " ms)" << "\n";
+	std::cout << "    contacts " << contactMismatch * 100.0 << "% mismatched (max " << CONTACT_TOLERANCE * 100.0f << "%), "
+		<< earlyContactMismatch * 100.0f << "% at worst over the first " << DRIFT_FRAMES << " frames (max " << EARLY_CONTACT_TOLERANCE * 100.0f << "%), first differ at frame " << firstContactDiff << "\n";
+	std::cout << "    momentum " << momentumError * 100.0f << "% (max " << MOMENTUM_TOLERANCE * 100.0f << "%), energy " << energyError * 100.0f << "% (max " << ENERGY_TOLERANCE * 100.0f << "%)" << "\n";
+	std::cout << "    drift " << earlyDrift << " m over the first " << DRIFT_FRAMES << " frames (max " << DRIFT_TOLERANCE << " m), " << finalDrift << " m at the end" << "\n";
+	if (firstCountDiff >= 0)
+	{
+		std::cout << "    circle count differs from frame " << firstCountDiff << "\n";
+	}
+	return passed;
+}
+
+std::string SolverDiff::getName(const Backend& backend)
+{
+	return backend.broadPhase + "/" + backend.solver;
+}
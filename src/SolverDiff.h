@@ -0,0 +1,46 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Differential check of the physics backends. The reference (every pair,
+// resolved one at a time) and each alternative run headless from the same
+// seed, one after another, and are compared frame by frame: contact sets,
+// total momentum, kinetic energy and position drift, plus the speed ratio.
+// Backends that resolve pairs in a different order are not bit-identical and
+// drift apart chaotically, so drift is judged over the first frames only.
+class SolverDiff
+{
+public:
+	SolverDiff(std::shared_ptr<sf::Font> font, std::uint32_t seed, int frames);
+	// Returns the number of backends outside the tolerances
+	int run();
+	struct Backend
+	{
+		std::string broadPhase;
+		std::string solver;
+	};
+private:
+	struct Frame
+	{
+		std::vector<std::pair<int, int>> contacts;
+		sf::Vector2f momentum;
+		float momentumScale;
+		float energy;
+		std::vector<sf::Vector2f> positions;
+	};
+	struct Trace
+	{
+		std::vector<Frame> frames;
+		float seconds;
+	};
+	std::shared_ptr<sf::Font> _font;
+	std::uint32_t _seed;
+	int _frames;
+	bool record(const Backend& backend, Trace& trace) const;
+	bool compare(const Backend& backend, const Trace& reference, const Trace& trace) const;
+	static std::string getName(const Backend& backend);
+};
@@ -0,0 +1,309 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	// Caps memory when a few tiny circles sit in a huge world
+	const int MAX_CELLS = 1 << 20;
+	const float MIN_CELL_SIZE = 0.01f;
+}
+
+SpatialGrid::SpatialGrid() :
+	_cellSize(1.0f),
+	_maxRadius(0.0f),
+	_columns(1),
+	_rows(1),
+	_cellStart(2, 0)
+{
+}
+
+void SpatialGrid::build(const std::vector<std::shared_ptr<MyCircle>>& circles, float width, float height, float margin)
+{
+	int count = static_cast<int>(circles.size());
+	_positions.resize(count);
+	_radii.resize(count);
+	_cellOf.resize(count);
+	_entries.resize(count);
+	_maxRadius = 0.0f;
+	_extentMin = sf::Vector2f(0.0f, 0.0f);
+	_extentMax = sf::Vector2f(width, height);
+	for (int i = 0; i < count; i++)
+	{
+		_positions[i] = circles[i]->getPositionInMetersFromPixels();
+		_radii[i] = circles[i]->getRadiusInMetersFromPixels();
+		_maxRadius = std::max(_maxRadius, _radii[i]);
+		_extentMin.x = std::min(_extentMin.x, _positions[i].x - _radii[i]);
+		_extentMin.y = std::min(_extentMin.y, _positions[i].y - _radii[i]);
+		_extentMax.x = std::max(_extentMax.x, _positions[i].x + _radii[i]);
+		_extentMax.y = std::max(_extentMax.y, _positions[i].y + _radii[i]);
+	}
+
+	_cellSize = chooseCellSize(count, _maxRadius, margin, width, height);
+	_columns = std::max(1, static_cast<int>(std::ceil(width / _cellSize)));
+	_rows = std::max(1, static_cast<int>(std::ceil(height / _cellSize)));
+
+	// Counting sort by cell, circles keep their index order inside a cell
+	int cells = _columns * _rows;
+	_cellStart.assign(cells + 1, 0);
+	for (int i = 0; i < count; i++)
+	{
+		_cellOf[i] = rowOf(_positions[i].y) * _columns + columnOf(_positions[i].x);
+		_cellStart[_cellOf[i] + 1]++;
+	}
+	for (int c = 0; c < cells; c++)
+	{
+		_cellStart[c + 1] += _cellStart[c];
+	}
+	_fill.assign(_cellStart.begin(), _cellStart.end() - 1);
+	for (int i = 0; i < count; i++)
+	{
+		_entries[_fill[_cellOf[i]]++] = i;
+	}
+}
+
+void SpatialGrid::reserve(const std::vector<std::shared_ptr<MyCircle>>& circles, float width, float height)
+{
+	int capacity = static_cast<int>(circles.capacity());
+	_positions.reserve(capacity);
+	_radii.reserve(capacity);
+	_cellOf.reserve(capacity);
+	_entries.reserve(capacity);
+	// A smaller largest circle means more cells, a build without margin needs the most
+	float maxRadius = 0.0f;
+	for (const auto& circle : circles)
+	{
+		maxRadius = std::max(maxRadius, circle->getRadiusInMetersFromPixels());
+	}
+	float cellSize = chooseCellSize(static_cast<int>(circles.size()), maxRadius, 0.0f, width, height);
+	int cells = std::max(1, static_cast<int>(std::ceil(width / cellSize))) * std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+	_cellStart.reserve(cells + 1);
+	_fill.reserve(cells);
+}
+
+float SpatialGrid::chooseCellSize(int count, float maxRadius, float margin, float width, float height)
+{
+	// No circles, one cell: an empty world would otherwise get the finest grid the cap allows
+	float cellSize = count > 0 ? std::max(2.0f * maxRadius + margin, MIN_CELL_SIZE) : std::max(std::max(width, height), MIN_CELL_SIZE);
+	while (std::ceil(width / cellSize) * std::ceil(height / cellSize) > MAX_CELLS)
+	{
+		cellSize *= 2.0f;
+	}
+	return cellSize;
+}
+
+int SpatialGrid::getCount() const
+{
+	return static_cast<int>(_positions.size());
+}
+
+float SpatialGrid::getMaxRadius() const
+{
+	return _maxRadius;
+}
+
+int SpatialGrid::columnOf(float x) const
+{
+	return std::clamp(static_cast<int>(std::floor(x / _cellSize)), 0, _columns - 1);
+}
+
+int SpatialGrid::rowOf(float y) const
+{
+	return std::clamp(static_cast<int>(std::floor(y / _cellSize)), 0, _rows - 1);
+}
+
+void SpatialGrid::queryRadius(sf::Vector2f center, float radius, std::vector<int>& out) const
+{
+	out.clear();
+	float reach = radius + _maxRadius;
+	int x0 = columnOf(center.x - reach);
+	int x1 = columnOf(center.x + reach);
+	int y0 = rowOf(center.y - reach);
+	int y1 = rowOf(center.y + reach);
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			int cell = cy * _columns + cx;
+			for (int e = _cellStart[cell]; e < _cellStart[cell + 1]; e++)
+			{
+				int i = _entries[e];
+				sf::Vector2f d = _positions[i] - center;
+				float limit = radius + _radii[i];
+				if (d.x * d.x + d.y * d.y <= limit * limit)
+				{
+					out.push_back(i);
+				}
+			}
+		}
+	}
+}
+
+void SpatialGrid::queryRect(sf::Vector2f min, sf::Vector2f max, std::vector<int>& out) const
+{
+	out.clear();
+	int x0 = columnOf(min.x - _maxRadius);
+	int x1 = columnOf(max.x + _maxRadius);
+	int y0 = rowOf(min.y - _maxRadius);
+	int y1 = rowOf(max.y + _maxRadius);
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			int cell = cy * _columns + cx;
+			for (int e = _cellStart[cell]; e < _cellStart[cell + 1]; e++)
+			{
+				int i = _entries[e];
+				// Distance from the centre to the closest point of the box
+				float dx = _positions[i].x - std::clamp(_positions[i].x, min.x, max.x);
+				float dy = _positions[i].y - std::clamp(_positions[i].y, min.y, max.y);
+				if (dx * dx + dy * dy <= _radii[i] * _radii[i])
+				{
+					out.push_back(i);
+				}
+			}
+		}
+	}
+}
+
+int SpatialGrid::pick(sf::Vector2f point) const
+{
+	int best = -1;
+	float bestDistance = std::numeric_limits<float>::max();
+	int x0 = columnOf(point.x - _maxRadius);
+	int x1 = columnOf(point.x + _maxRadius);
+	int y0 = rowOf(point.y - _maxRadius);
+	int y1 = rowOf(point.y + _maxRadius);
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			int cell = cy * _columns + cx;
+			for (int e = _cellStart[cell]; e < _cellStart[cell + 1]; e++)
+			{
+				int i = _entries[e];
+				sf::Vector2f d = _positions[i] - point;
+				float distance = d.x * d.x + d.y * d.y;
+				if (distance <= _radii[i] * _radii[i] && distance < bestDistance)
+				{
+					best = i;
+					bestDistance = distance;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+float SpatialGrid::raycastCell(int cx, int cy, sf::Vector2f origin, sf::Vector2f direction, float best, int& hit) const
+{
+	int cell = cy * _columns + cx;
+	for (int e = _cellStart[cell]; e < _cellStart[cell + 1]; e++)
+	{
+		int i = _entries[e];
+		sf::Vector2f m = origin - _positions[i];
+		float b = m.x * direction.x + m.y * direction.y;
+		float c = m.x * m.x + m.y * m.y - _radii[i] * _radii[i];
+		float t = 0.0f;
+		if (c > 0.0f)
+		{
+			float discriminant = b * b - c;
+			if (b > 0.0f || discriminant < 0.0f)
+			{
+				continue;
+			}
+			t = -b - std::sqrt(discriminant);
+		}
+		if (t < best)
+		{
+			best = t;
+			hit = i;
+		}
+	}
+	return best;
+}
+
+int SpatialGrid::raycast(sf::Vector2f origin, sf::Vector2f direction, float maxDistance, float& hitDistance) const
+{
+	float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+	if (length <= 0.0f || _positions.empty())
+	{
+		return -1;
+	}
+	direction /= length;
+
+	// Clip the ray to the box around the grid and every circle, then walk the
+	// cells it crosses in order. Cells past the grid edge are walked too, their
+	// circles were clamped into the edge cells when the grid was built.
+	float boxMin[2] = { std::min(0.0f, _extentMin.x), std::min(0.0f, _extentMin.y) };
+	float boxMax[2] = { std::max(_columns * _cellSize, _extentMax.x), std::max(_rows * _cellSize, _extentMax.y) };
+	float o[2] = { origin.x, origin.y };
+	float d[2] = { direction.x, direction.y };
+	float tEnter = 0.0f;
+	float tExit = maxDistance;
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (std::abs(d[axis]) < 1e-12f)
+		{
+			if (o[axis] < boxMin[axis] || o[axis] > boxMax[axis])
+			{
+				return -1;
+			}
+			continue;
+		}
+		float t0 = (boxMin[axis] - o[axis]) / d[axis];
+		float t1 = (boxMax[axis] - o[axis]) / d[axis];
+		tEnter = std::max(tEnter, std::min(t0, t1));
+		tExit = std::min(tExit, std::max(t0, t1));
+	}
+	if (tEnter > tExit)
+	{
+		return -1;
+	}
+
+	sf::Vector2f start = origin + direction * tEnter;
+	int cx = static_cast<int>(std::floor(start.x / _cellSize));
+	int cy = static_cast<int>(std::floor(start.y / _cellSize));
+	int stepX = direction.x > 0.0f ? 1 : -1;
+	int stepY = direction.y > 0.0f ? 1 : -1;
+	float infinity = std::numeric_limits<float>::max();
+	float tDeltaX = direction.x != 0.0f ? _cellSize / std::abs(direction.x) : infinity;
+	float tDeltaY = direction.y != 0.0f ? _cellSize / std::abs(direction.y) : infinity;
+	float tMaxX = direction.x != 0.0f ? ((cx + (stepX > 0 ? 1 : 0)) * _cellSize - origin.x) / direction.x : infinity;
+	float tMaxY = direction.y != 0.0f ? ((cy + (stepY > 0 ? 1 : 0)) * _cellSize - origin.y) / direction.y : infinity;
+
+	int hit = -1;
+	float best = maxDistance;
+	for (;;)
+	{
+		// A circle whose first hit lies in this cell has its centre here or next door
+		for (int ny = std::clamp(cy - 1, 0, _rows - 1); ny <= std::clamp(cy + 1, 0, _rows - 1); ny++)
+		{
+			for (int nx = std::clamp(cx - 1, 0, _columns - 1); nx <= std::clamp(cx + 1, 0, _columns - 1); nx++)
+			{
+				best = raycastCell(nx, ny, origin, direction, best, hit);
+			}
+		}
+		float tCellExit = std::min(tMaxX, tMaxY);
+		if ((hit >= 0 && best <= tCellExit) || tCellExit > tExit)
+		{
+			break;
+		}
+		if (tMaxX < tMaxY)
+		{
+			cx += stepX;
+			tMaxX += tDeltaX;
+		}
+		else
+		{
+			cy += stepY;
+			tMaxY += tDeltaY;
+		}
+	}
+	if (hit >= 0)
+	{
+		hitDistance = best;
+	}
+	return hit;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "MyCircle.h"
+#include <SFML/System/Vector2.hpp>
+#include <memory>
+#include <vector>
+
+// Uniform grid over circle centres in meters, rebuilt every physics step with
+// a counting sort. Cells are at least as wide as the largest circle, so a
+// circle touching a cell has its centre in that cell or a neighbour. A query
+// costs the cells it covers plus the circles in them, not the whole world.
+// Circles outside the world bounds are kept in the border cells. A margin
+// widens the cells so candidate pairs also cover circles that far apart.
+class SpatialGrid
+{
+public:
+	SpatialGrid();
+	void build(const std::vector<std::shared_ptr<MyCircle>>& circles, float width, float height, float margin = 0.0f);
+	// Grows the arrays a build over these circles needs, where circles are created
+	void reserve(const std::vector<std::shared_ptr<MyCircle>>& circles, float width, float height);
+	int getCount() const;
+	// Largest radius at the last build, how far a circle can reach out of its cell
+	float getMaxRadius() const;
+	// Calls visit(i, j) with i < j once for every pair in the same or adjacent cells
+	template <typename Visit>
+	void forEachCandidatePair(Visit& visit) const
+	{
+		// Half the neighbourhood per cell, the other half visits this one
+		static const int OFFSETS[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+		for (int cy = 0; cy < _rows; cy++)
+		{
+			for (int cx = 0; cx < _columns; cx++)
+			{
+				int cell = cy * _columns + cx;
+				int begin = _cellStart[cell];
+				int end = _cellStart[cell + 1];
+				for (int a = begin; a < end; a++)
+				{
+					for (int b = a + 1; b < end; b++)
+					{
+						visit(_entries[a], _entries[b]);
+					}
+				}
+				for (const int* offset : OFFSETS)
+				{
+					int nx = cx + offset[0];
+					int ny = cy + offset[1];
+					if (nx < 0 || nx >= _columns || ny >= _rows)
+					{
+						continue;
+					}
+					int neighbour = ny * _columns + nx;
+					for (int a = begin; a < end; a++)
+					{
+						for (int b = _cellStart[neighbour]; b < _cellStart[neighbour + 1]; b++)
+						{
+							int i = _entries[a];
+							int j = _entries[b];
+							visit(i < j ? i : j, i < j ? j : i);
+						}
+					}
+				}
+			}
+		}
+	}
+	// Circles overlapping the disc, indices into the circles given to build
+	void queryRadius(sf::Vector2f center, float radius, std::vector<int>& out) const;
+	// Circles overlapping the box
+	void queryRect(sf::Vector2f min, sf::Vector2f max, std::vector<int>& out) const;
+	// First circle along the ray within maxDistance, -1 if none
+	int raycast(sf::Vector2f origin, sf::Vector2f direction, float maxDistance, float& hitDistance) const;
+	// Circle containing the point, the nearest centre wins, -1 if none
+	int pick(sf::Vector2f point) const;
+private:
+	float _cellSize;
+	float _maxRadius;
+	int _columns;
+	int _rows;
+	std::vector<int> _cellStart;
+	std::vector<int> _fill;
+	std::vector<int> _entries;
+	std::vector<int> _cellOf;
+	std::vector<sf::Vector2f> _positions;
+	std::vector<float> _radii;
+	// Box around every circle, which may reach past the grid
+	sf::Vector2f _extentMin;
+	sf::Vector2f _extentMax;
+	static float chooseCellSize(int count, float maxRadius, float margin, float width, float height);
+	int columnOf(float x) const;
+	int rowOf(float y) const;
+	float raycastCell(int cx, int cy, sf::Vector2f origin, sf::Vector2f direction, float best, int& hit) const;
+};
@@ -0,0 +1,226 @@
+#include "TextBatch.h"
+#include "Counters.h"
+
+TextBatch::TextBatch()
+{
+}
+
+int TextBatch::add(const sf::Text& text, const sf::Color& color)
+{
+	int id;
+	if (!_freeIds.empty())
+	{
+		id = _freeIds.back();
+		_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<int>(_entries.size());
+		_entries.emplace_back();
+	}
+	Entry& entry = _entries[id];
+	entry.alive = true;
+	entry.color = color;
+	attach(id, text);
+	return id;
+}
+
+void TextBatch::update(int id, const sf::Text& text)
+{
+	detach(id);
+	attach(id, text);
+}
+
+void TextBatch::setColor(int id, const sf::Color& color)
+{
+	Entry& entry = _entries[id];
+	if (entry.color == color)
+	{
+		return;
+	}
+	entry.color = color;
+
+	// Write straight into the page, a dirty page picks the colour up on rebuild
+	Page& page = _pages[entry.page];
+	if (page.dirty)
+	{
+		return;
+	}
+	sf::Vertex* vertices = page.vertices.data() + entry.offset;
+	for (size_t i = 0; i < entry.vertices.size(); i++)
+	{
+		vertices[i].color = color;
+	}
+}
+
+void TextBatch::remove(int id)
+{
+	detach(id);
+	_entries[id].alive = false;
+	_entries[id].vertices.clear();
+	_freeIds.push_back(id);
+}
+
+size_t TextBatch::getVertexCount() const
+{
+	size_t count = 0;
+	for (const Page& page : _pages)
+	{
+		count += page.vertices.size();
+	}
+	return count;
+}
+
+size_t TextBatch::getPageCount() const
+{
+	return _pages.size();
+}
+
+const sf::Texture* TextBatch::getPageTexture(size_t page) const
+{
+	return _pages[page].texture;
+}
+
+const std::vector<sf::Vertex>& TextBatch::getPageVertices(size_t page) const
+{
+	if (_pages[page].dirty)
+	{
+		rebuild(_pages[page]);
+	}
+	return _pages[page].vertices;
+}
+
+unsigned int TextBatch::getPageRevision(size_t page) const
+{
+	return _pages[page].revision;
+}
+
+void TextBatch::attach(int id, const sf::Text& text)
+{
+	Entry& entry = _entries[id];
+	buildGlyphs(text, entry);
+
+	const sf::Texture* texture = &text.getFont()->getTexture(text.getCharacterSize());
+	entry.page = -1;
+	for (size_t p = 0; p < _pages.size(); p++)
+	{
+		if (_pages[p].texture == texture)
+		{
+			entry.page = static_cast<int>(p);
+			break;
+		}
+	}
+	if (entry.page < 0)
+	{
+		entry.page = static_cast<int>(_pages.size());
+		_pages.push_back({ texture, {}, {}, false, 0 });
+	}
+	_pages[entry.page].entries.push_back(id);
+	_pages[entry.page].dirty = true;
+	_pages[entry.page].revision++;
+}
+
+void TextBatch::detach(int id)
+{
+	Page& page = _pages[_entries[id].page];
+	page.entries.erase(std::remove(page.entries.begin(), page.entries.end(), id), page.entries.end());
+	page.dirty = true;
+}
+
+void TextBatch::buildGlyphs(const sf::Text& text, Entry& entry)
+{
+	// Same layout as sf::Text for regular style without outline
+	const sf::Font& font = *text.getFont();
+	unsigned int size = text.getCharacterSize();
+	const sf::String& string = text.getString();
+	const sf::Transform& transform = text.getTransform();
+
+	float whitespaceWidth = font.getGlyph(L' ', size, false).advance;
+	float letterSpacing = (whitespaceWidth / 3.0f) * (text.getLetterSpacing() - 1.0f);
+	whitespaceWidth += letterSpacing;
+	float lineSpacing = font.getLineSpacing(size) * text.getLineSpacing();
+
+	float x = 0.0f;
+	float y = static_cast<float>(size);
+	sf::Uint32 prevChar = 0;
+	entry.vertices.clear();
+	for (size_t i = 0; i < string.getSize(); i++)
+	{
+		sf::Uint32 curChar = string[i];
+		if (curChar == L'\r')
+		{
+			continue;
+		}
+		x += font.getKerning(prevChar, curChar, size);
+		prevChar = curChar;
+
+		if (curChar == L' ' || curChar == L'\n' || curChar == L'\t')
+		{
+			switch (curChar)
+			{
+			case L' ':  x += whitespaceWidth; break;
+			case L'\t': x += whitespaceWidth * 4; break;
+			case L'\n': y += lineSpacing; x = 0; break;
+			}
+			continue;
+		}
+
+		const sf::Glyph& glyph = font.getGlyph(curChar, size, false);
+		float left = glyph.bounds.left;
+		float top = glyph.bounds.top;
+		float right = glyph.bounds.left + glyph.bounds.width;
+		float bottom = glyph.bounds.top + glyph.bounds.height;
+		float u1 = static_cast<float>(glyph.textureRect.left);
+		float v1 = static_cast<float>(glyph.textureRect.top);
+		float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width);
+		float v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height);
+
+		sf::Vertex quad[6] =
+		{
+			sf::Vertex(transform.transformPoint(x + left, y + top), entry.color, sf::Vector2f(u1, v1)),
+			sf::Vertex(transform.transformPoint(x + right, y + top), entry.color, sf::Vector2f(u2, v1)),
+			sf::Vertex(transform.transformPoint(x + left, y + bottom), entry.color, sf::Vector2f(u1, v2)),
+			sf::Vertex(transform.transformPoint(x + left, y + bottom), entry.color, sf::Vector2f(u1, v2)),
+			sf::Vertex(transform.transformPoint(x + right, y + top), entry.color, sf::Vector2f(u2, v1)),
+			sf::Vertex(transform.transformPoint(x + right, y + bottom), entry.color, sf::Vector2f(u2, v2))
+		};
+		entry.vertices.insert(entry.vertices.end(), quad, quad + 6);
+
+		x += glyph.advance + letterSpacing;
+	}
+}
+
+void TextBatch::rebuild(Page& page) const
+{
+	page.vertices.clear();
+	for (int id : page.entries)
+	{
+		const Entry& entry = _entries[id];
+		entry.offset = page.vertices.size();
+		for (const sf::Vertex& vertex : entry.vertices)
+		{
+			page.vertices.push_back(vertex);
+			page.vertices.back().color = entry.color;
+		}
+	}
+	page.dirty = false;
+}
+
+void TextBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	for (Page& page : _pages)
+	{
+		if (page.dirty)
+		{
+			rebuild(page);
+		}
+		if (page.vertices.empty())
+		{
+			continue;
+		}
+		states.texture = page.texture;
+		target.draw(page.vertices.data(), page.vertices.size(), sf::Triangles, states);
+		PROFILE_COUNT(Counters::DrawCalls, 1);
+		PROFILE_COUNT(Counters::Vertices, static_cast<std::int64_t>(page.vertices.size()));
+	}
+}
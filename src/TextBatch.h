@@ -0,0 +1,49 @@
+#pragma once
+#include "SFML/Graphics.hpp"
+#include <algorithm>
+#include <vector>
+
+// Draws many texts sharing a font with one draw call per glyph page
+// (SFML keeps one atlas page per character size). Glyph quads are built once
+// per string, colour changes only rewrite the colour of that text's vertices.
+class TextBatch : public sf::Drawable
+{
+public:
+	TextBatch();
+	int add(const sf::Text& text, const sf::Color& color);
+	void update(int id, const sf::Text& text);
+	void setColor(int id, const sf::Color& color);
+	void remove(int id);
+	size_t getVertexCount() const;
+	size_t getPageCount() const;
+	// Page access for renderers other than SFML's. The revision changes whenever
+	// a text joins the page, which is when the atlas may have gained glyphs
+	const sf::Texture* getPageTexture(size_t page) const;
+	const std::vector<sf::Vertex>& getPageVertices(size_t page) const;
+	unsigned int getPageRevision(size_t page) const;
+private:
+	struct Entry
+	{
+		bool alive;
+		int page;
+		mutable size_t offset;
+		sf::Color color;
+		std::vector<sf::Vertex> vertices;
+	};
+	struct Page
+	{
+		const sf::Texture* texture;
+		std::vector<sf::Vertex> vertices;
+		std::vector<int> entries;
+		bool dirty;
+		unsigned int revision;
+	};
+	std::vector<Entry> _entries;
+	std::vector<int> _freeIds;
+	mutable std::vector<Page> _pages;
+	void buildGlyphs(const sf::Text& text, Entry& entry);
+	void attach(int id, const sf::Text& text);
+	void detach(int id);
+	void rebuild(Page& page) const;
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
@@ -0,0 +1,111 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) :
+	_function(nullptr),
+	_task(nullptr),
+	_count(0),
+	_grain(1),
+	_next(0),
+	_busy(0),
+	_generation(0),
+	_stopping(false)
+{
+	int workers = resolveThreadCount(threads) - 1;
+	for (int i = 0; i < workers; i++)
+	{
+		_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+int ThreadPool::getThreadCount() const
+{
+	return static_cast<int>(_workers.size()) + 1;
+}
+
+int ThreadPool::resolveThreadCount(int threads)
+{
+	if (threads > 0)
+	{
+		return threads;
+	}
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::run(int count, int grain, TaskFunction function, void* task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	grain = std::max(1, grain);
+	// Not worth waking anyone for a single chunk
+	if (_workers.empty() || count <= grain)
+	{
+		function(task, 0, count);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_function = function;
+		_task = task;
+		_count = count;
+		_grain = grain;
+		_next.store(0, std::memory_order_relaxed);
+		_busy = static_cast<int>(_workers.size());
+		_generation++;
+	}
+	_wake.notify_all();
+	runChunks();
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this] { return _busy == 0; });
+}
+
+void ThreadPool::runChunks()
+{
+	for (;;)
+	{
+		int begin = _next.fetch_add(_grain, std::memory_order_relaxed);
+		if (begin >= _count)
+		{
+			return;
+		}
+		_function(_task, begin, std::min(_count, begin + _grain));
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	std::uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this, seen] { return _stopping || _generation != seen; });
+			if (_stopping)
+			{
+				return;
+			}
+			seen = _generation;
+		}
+		runChunks();
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (--_busy == 0)
+		{
+			_finished.notify_one();
+		}
+	}
+}
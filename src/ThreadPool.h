@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel phases. parallelFor splits
+// [0, count) into chunks of grain items, the calling thread takes chunks too
+// and returns once every chunk has run. Tasks are passed by reference and
+// never copied, so a frame's parallel work allocates nothing.
+class ThreadPool
+{
+public:
+	// threads counts the caller, 0 = one per core
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+	int getThreadCount() const;
+	template <typename Task>
+	void parallelFor(int count, int grain, Task& task)
+	{
+		run(count, grain, &invoke<Task>, &task);
+	}
+	static int resolveThreadCount(int threads);
+private:
+	typedef void (*TaskFunction)(void* task, int begin, int end);
+	template <typename Task>
+	static void invoke(void* task, int begin, int end)
+	{
+		(*static_cast<Task*>(task))(begin, end);
+	}
+	void run(int count, int grain, TaskFunction function, void* task);
+	void runChunks();
+	void workerLoop();
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _finished;
+	TaskFunction _function;
+	void* _task;
+	int _count;
+	int _grain;
+	std::atomic<int> _next;
+	int _busy;
+	std::uint64_t _generation;
+	bool _stopping;
+};
@@ -0,0 +1,54 @@
+#include "World.h"
+#include <SFML/Window/VideoMode.hpp>
+
+namespace
+{
+	thread_local World* currentWorld = nullptr;
+}
+
+World::World(int index, sf::Vector2u size, std::uint32_t seed) :
+	conversionFactor(1.0f),
+	random(seed),
+	seed(seed),
+	introComplete(false),
+	objectCount(0),
+	blockTextSpawn(false),
+	textCount(0),
+	textHue(0.0f),
+	circleHue(0.0f),
+	_index(index),
+	_size(size)
+{
+	textHue = static_cast<float>(std::uniform_int_distribution<int>(0, 360)(random));
+}
+
+World& World::current()
+{
+	if (!currentWorld)
+	{
+		sf::VideoMode desktop = sf::VideoMode::getDesktopMode();
+		thread_local World fallback(0, sf::Vector2u(desktop.width, desktop.height), std::random_device()());
+		currentWorld = &fallback;
+	}
+	return *currentWorld;
+}
+
+void World::setCurrent(World* world)
+{
+	currentWorld = world;
+}
+
+int World::getIndex() const
+{
+	return _index;
+}
+
+bool World::isPrimary() const
+{
+	return _index == 0;
+}
+
+sf::Vector2u World::getSize() const
+{
+	return _size;
+}
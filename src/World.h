@@ -0,0 +1,39 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+class MyText;
+
+// Everything one simulation owns. Several worlds can run side by side, each
+// stepped by its own thread; that thread makes its world current first, and the
+// static accessors (Settings, Random, GameManager::isIntroFinished, ...) read
+// the current world. A thread that never sets one gets a default world.
+class World
+{
+public:
+	World(int index, sf::Vector2u size, std::uint32_t seed);
+	static World& current();
+	static void setCurrent(World* world);
+	int getIndex() const;
+	// The primary world drives process-wide work: profiler frames, config polling
+	bool isPrimary() const;
+	sf::Vector2u getSize() const;
+
+	float conversionFactor;
+	std::mt19937 random;
+	std::uint32_t seed;
+	bool introComplete;
+	int objectCount;
+	// Text fade sequencing, see MyText
+	std::deque<MyText*> fadeInQueue;
+	std::deque<MyText*> fadeOutQueue;
+	bool blockTextSpawn;
+	int textCount;
+	float textHue;
+	float circleHue;
+private:
+	int _index;
+	sf::Vector2u _size;
+};
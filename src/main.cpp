@@ -1,39 +1,576 @@
 #include <iostream>;
 #include "MyCircle.h";
 #include "GameManager.h";
-const int FPS = 144;
+#include "Scenario.h"
+#include "InputRecorder.h"
+#include "Random.h"
+#include "Assets.h"
+#include "Config.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
+#include "World.h"
+#include "BarnesHut.h"
+#include "SolverDiff.h"
+#include "QueryCheck.h"
+#include "FrameCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+// Timestep of recordings when the frame cap is off
+const int RECORD_RATE = 144;
+// Frames of a headless scenario skipped before the zero-allocation budget applies,
+// while the pools and scratch arrays grow to their working size
+const int ALLOC_WARMUP_FRAMES = 600;
+// Thread counts --verify-determinism compares
+const int VERIFY_THREADS[] = { 1, 2, 8, 16 };
+// World size of the headless checks and renders, fixed so results don't depend on the desktop
+const sf::Vector2u CHECK_SIZE(1920, 1080);
+// Frame rate of captures unless --fps says otherwise
+const int CAPTURE_RATE = 60;
 
-sf::RenderWindow* createWindow() 
+struct Options
+{
+    std::string config = "RetroScreenSaver.ini";
+    std::string scenario;
+    std::string record;
+    std::string replay;
+    std::string out = "scenario_result.json";
+    bool headless = false;
+    bool hasSeed = false;
+    std::uint32_t seed = 0;
+    std::string baseline;
+    std::string current;
+    float threshold = 10.0f;
+    int worlds = 1;
+    int frames = 1000;
+    int benchBodies = 0;
+    bool verifyDeterminism = false;
+    bool diffSolvers = false;
+    bool verifyQueries = false;
+    std::string render;
+    std::string capture;
+    int fps = CAPTURE_RATE;
+    sf::Vector2u size = CHECK_SIZE;
+};
+
+sf::RenderWindow* createWindow(const Config::WindowRect* rect = nullptr) 
 {
-    sf::VideoMode res = sf::VideoMode::getDesktopMode();
-    int width = res.width;
-    int height = res.height;
     sf::ContextSettings settings;
     settings.antialiasingLevel = 8;
-    sf::RenderWindow* window = new sf::RenderWindow(sf::VideoMode(width, height), "PhysicsSandbox", sf::Style::Fullscreen, settings);
-    window->setFramerateLimit(FPS);
+    sf::RenderWindow* window = nullptr;
+    if (!rect)
+    {
+        sf::VideoMode res = sf::VideoMode::getDesktopMode();
+        int width = res.width;
+        int height = res.height;
+        window = new sf::RenderWindow(sf::VideoMode(width, height), "PhysicsSandbox", sf::Style::Fullscreen, settings);
+    }
+    else
+    {
+        // Fullscreen only reaches the primary monitor, other displays get a borderless window over them
+        window = new sf::RenderWindow(sf::VideoMode(rect->width, rect->height), "PhysicsSandbox", sf::Style::None, settings);
+        window->setPosition(sf::Vector2i(rect->x, rect->y));
+    }
+    window->setFramerateLimit(Config::get().frameCap);
     return window;
 }
-void run() 
-{
 
-    static std::shared_ptr<sf::Font> font = std::make_shared<sf::Font>();
-    if (!font->loadFromFile("Fonts/arial.ttf"))
+std::shared_ptr<sf::Font> loadFont()
+{
+    // sf::Font caches glyphs as it draws, so every world gets its own
+    std::shared_ptr<sf::Font> font = std::make_shared<sf::Font>();
+    const void* fontData = nullptr;
+    std::size_t fontSize = 0;
+    if (!Assets::get("Fonts/arial.ttf", fontData, fontSize) || !font->loadFromMemory(fontData, fontSize))
     {
         std::cout << "Error loading arial.ttf";
+        return nullptr;
+    }
+    std::cout << "FONT: arial.ttf loaded - SUCCESS" << "\n";
+    return font;
+}
+
+bool parseSize(const std::string& text, sf::Vector2u& size)
+{
+    // <width>x<height>
+    size_t separator = text.find('x');
+    if (separator == std::string::npos)
+    {
+        return false;
+    }
+    int width = std::atoi(text.substr(0, separator).c_str());
+    int height = std::atoi(text.substr(separator + 1).c_str());
+    if (width <= 0 || height <= 0)
+    {
+        return false;
+    }
+    size = sf::Vector2u(width, height);
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--scenario" && hasValue)
+        {
+            options.scenario = argv[++i];
+        }
+        else if (arg == "--record" && hasValue)
+        {
+            options.record = argv[++i];
+        }
+        else if (arg == "--replay" && hasValue)
+        {
+            options.replay = argv[++i];
+        }
+        else if (arg == "--config" && hasValue)
+        {
+            options.config = argv[++i];
+        }
+        else if (arg == "--assets" && hasValue)
+        {
+            Assets::setOverrideDirectory(argv[++i]);
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            options.out = argv[++i];
+        }
+        else if (arg == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            options.hasSeed = true;
+            options.seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--compare" && i + 2 < argc)
+        {
+            options.baseline = argv[++i];
+            options.current = argv[++i];
+        }
+        else if (arg == "--threshold" && hasValue)
+        {
+            options.threshold = std::stof(argv[++i]);
+        }
+        else if (arg == "--worlds" && hasValue)
+        {
+            options.worlds = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            options.frames = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--bench-nbody" && hasValue)
+        {
+            options.benchBodies = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--verify-determinism")
+        {
+            options.verifyDeterminism = true;
+        }
+        else if (arg == "--diff-solvers")
+        {
+            options.diffSolvers = true;
+        }
+        else if (arg == "--verify-queries")
+        {
+            options.verifyQueries = true;
+        }
+        else if (arg == "--render" && hasValue)
+        {
+            options.render = argv[++i];
+        }
+        else if (arg == "--capture" && hasValue)
+        {
+            options.capture = argv[++i];
+        }
+        else if (arg == "--fps" && hasValue)
+        {
+            options.fps = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--size" && hasValue && parseSize(argv[i + 1], options.size))
+        {
+            i++;
+        }
+        else
+        {
+            std::cout << "Unknown or incomplete option " << arg << "\n";
+            std::cout << "Usage: RetroScreenSaver [--config <file>] [--assets <dir>]" << "\n";
+            std::cout << "       RetroScreenSaver --scenario <file> [--headless] [--seed <n>] [--out <file>]" << "\n";
+            std::cout << "       RetroScreenSaver --record <file> [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --replay <file> [--headless]" << "\n";
+            std::cout << "       RetroScreenSaver --compare <baseline> <current> [--threshold <percent>]" << "\n";
+            std::cout << "       RetroScreenSaver --headless [--worlds <n>] [--frames <n>] [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --bench-nbody <bodies> [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --verify-determinism [--frames <n>] [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --diff-solvers [--frames <n>] [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --verify-queries [--frames <n>] [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --render <image> [--frames <n>] [--seed <n>]" << "\n";
+            std::cout << "       RetroScreenSaver --capture <file.y4m|frames/%05d.png|\"|command\"> [--size <w>x<h>] [--fps <n>] [--frames <n>] [--seed <n>]" << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int runScenario(const Options& options, std::shared_ptr<sf::Font> font)
+{
+    Scenario scenario;
+    if (!scenario.load(options.scenario))
+    {
+        return 1;
+    }
+    if (options.hasSeed)
+    {
+        scenario.setSeed(options.seed);
+    }
+
+    sf::RenderWindow* window = nullptr;
+    if (!options.headless)
+    {
+        // Uncapped and at full resolution so the timings measure the work, not the limiter
+        window = createWindow();
+        window->setFramerateLimit(0);
+    }
+    bool completed = false;
+    {
+        GameManager game(window, font);
+        game.setRenderScale(1.0f);
+        completed = scenario.run(game, window);
+        if (completed)
+        {
+            completed = scenario.writeJson(options.out, options.headless);
+        }
+    }
+    delete window;
+    return completed ? 0 : 1;
+}
+
+int runRecorded(const Options& options, std::shared_ptr<sf::Font> font)
+{
+    // Both sides run at a fixed timestep from the same seed, so a replay is bit-identical
+    InputRecorder input;
+    sf::RenderWindow* window = nullptr;
+    if (!options.replay.empty())
+    {
+        if (!input.startReplay(options.replay))
+        {
+            return 1;
+        }
+        sf::VideoMode desktop = sf::VideoMode::getDesktopMode();
+        if (desktop.width != input.getWindowSize().x || desktop.height != input.getWindowSize().y)
+        {
+            std::cout << "INPUTRECORDER: recorded at " << input.getWindowSize().x << "x" << input.getWindowSize().y
+                << ", this desktop is " << desktop.width << "x" << desktop.height << ", the replay will diverge" << "\n";
+        }
+        if (!options.headless)
+        {
+            window = createWindow();
+        }
     }
     else
-    {         
-        std::cout << "FONT: arial.ttf loaded - SUCCESS" << "\n";
-        sf::RenderWindow* window = createWindow();
+    {
+        std::uint32_t seed = options.hasSeed ? options.seed : Random::getSeed();
+        window = createWindow();
+        int rate = Config::get().frameCap > 0 ? Config::get().frameCap : RECORD_RATE;
+        if (!input.startRecording(options.record, seed, 1.0f / rate, window->getSize()))
+        {
+            delete window;
+            return 1;
+        }
+    }
+    Random::seed(input.getSeed());
+    {
         GameManager game(window, font);
-        delete window;
+        game.setFixedTimestep(input.getTimestep());
+        game.setInputRecorder(&input);
+        game.run();
+    }
+    delete window;
+    return 0;
+}
+
+void runWorld(int index, const Config::WindowRect* rect, const Options& options, std::uint32_t seed)
+{
+    // The window is created here too, a window's events can only be polled by the thread that made it
+#ifdef RSS_PROFILING
+    if (index > 0)
+    {
+        Profiler::setThreadName("World " + std::to_string(index));
+    }
+#endif
+    sf::VideoMode desktop = sf::VideoMode::getDesktopMode();
+    sf::Vector2u size = rect ? sf::Vector2u(rect->width, rect->height) : sf::Vector2u(desktop.width, desktop.height);
+    World world(index, size, seed);
+    World::setCurrent(&world);
+    std::shared_ptr<sf::Font> font = loadFont();
+    if (!font)
+    {
+        return;
+    }
+    if (options.headless)
+    {
+        GameManager game(nullptr, font);
+        for (int i = 0; i < options.frames; i++)
+        {
+            game.step(1.0f / RECORD_RATE);
+        }
+        return;
+    }
+    sf::RenderWindow* window = createWindow(rect);
+    {
+        GameManager game(window, font);
+        game.run();
+    }
+    delete window;
+}
+
+int runWorlds(const Options& options)
+{
+    // Every world steps on its own thread, world 0 stays on the main thread
+    std::vector<Config::WindowRect> windows = Config::get().windows;
+    int count = options.headless ? options.worlds : std::max(1, static_cast<int>(windows.size()));
+    std::uint32_t seed = options.hasSeed ? options.seed : Random::getSeed();
+    std::cout << "WORLDS: " << count << (options.headless ? " headless" : "") << ", seed " << seed << "\n";
+    sf::Clock clock;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < count; i++)
+    {
+        const Config::WindowRect* rect = !options.headless && i < static_cast<int>(windows.size()) ? &windows[i] : nullptr;
+        threads.emplace_back(runWorld, i, rect, std::cref(options), seed + i);
+    }
+    runWorld(0, windows.empty() || options.headless ? nullptr : &windows[0], options, seed);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    if (options.headless)
+    {
+        float seconds = clock.getElapsedTime().asSeconds();
+        std::cout << "WORLDS: " << count << " x " << options.frames << " frames in " << seconds * 1000.0f << " ms, "
+            << count * options.frames / seconds << " world frames/s" << "\n";
+    }
+    return 0;
+}
+
+int verifyDeterminism(const Options& options)
+{
+    // The parallel solver must give a bit-identical world whatever the thread count
+    std::shared_ptr<sf::Font> font = loadFont();
+    if (!font || !Config::override("physics.solver", "parallel"))
+    {
+        return 1;
     }
+    std::uint32_t seed = options.hasSeed ? options.seed : Random::getSeed();
+    std::cout << "DETERMINISM: " << options.frames << " frames, seed " << seed << "\n";
+    std::uint64_t expected = 0;
+    bool identical = true;
+    for (int threads : VERIFY_THREADS)
+    {
+        Config::override("physics.threads", std::to_string(threads));
+        World world(0, CHECK_SIZE, seed);
+        World::setCurrent(&world);
+        std::uint64_t hash = 0;
+        {
+            GameManager game(nullptr, font);
+            for (int i = 0; i < options.frames; i++)
+            {
+                game.step(1.0f / RECORD_RATE);
+            }
+            hash = game.getStateHash();
+        }
+        World::setCurrent(nullptr);
+        if (threads == VERIFY_THREADS[0])
+        {
+            expected = hash;
+        }
+        identical = identical && hash == expected;
+        std::cout << "DETERMINISM: " << threads << " threads, state hash " << std::hex << hash << std::dec
+            << (hash == expected ? "" : " DIVERGED") << "\n";
+    }
+    std::cout << "DETERMINISM: " << (identical ? "all thread counts match" : "FAILED") << "\n";
+    return identical ? 0 : 1;
 }
 
-int main()
+int renderSoftware(const Options& options)
 {
-    run();
+    // Steps a headless world and draws every frame on the CPU, the last frame is saved
+    std::shared_ptr<sf::Font> font = loadFont();
+    if (!font)
+    {
+        return 1;
+    }
+    std::uint32_t seed = options.hasSeed ? options.seed : Random::getSeed();
+    World world(0, CHECK_SIZE, seed);
+    World::setCurrent(&world);
+    SoftwareRenderer renderer(CHECK_SIZE, Config::get().threads);
+    float renderSeconds = 0.0f;
+    {
+        GameManager game(nullptr, font);
+        sf::Clock clock;
+        for (int i = 0; i < options.frames; i++)
+        {
+            game.step(1.0f / RECORD_RATE);
+            clock.restart();
+            game.renderSoftware(renderer);
+            renderSeconds += clock.getElapsedTime().asSeconds();
+        }
+    }
+    World::setCurrent(nullptr);
+    std::cout << "SOFTWARE: " << options.frames << " frames at " << CHECK_SIZE.x << "x" << CHECK_SIZE.y << ", seed " << seed
+        << ", " << renderSeconds * 1000.0f / options.frames << " ms per frame" << "\n";
+    std::cout << "SOFTWARE: image hash " << std::hex << renderer.getHash() << std::dec << "\n";
+    if (!renderer.saveToFile(options.render))
+    {
+        std::cout << "SOFTWARE: failed to write " << options.render << "\n";
+        return 1;
+    }
+    std::cout << "SOFTWARE: last frame written to " << options.render << "\n";
     return 0;
 }
 
+int captureFrames(const Options& options)
+{
+    // A hidden window at the capture size, stepped at the capture's rate whatever the render takes,
+    // so the video plays back in real time and nothing perturbs the frames like a screen recorder
+    std::shared_ptr<sf::Font> font = loadFont();
+    if (!font)
+    {
+        return 1;
+    }
+    std::uint32_t seed = options.hasSeed ? options.seed : Random::getSeed();
+    World world(0, options.size, seed);
+    World::setCurrent(&world);
+    Config::WindowRect rect = { 0, 0, static_cast<int>(options.size.x), static_cast<int>(options.size.y) };
+    sf::RenderWindow* window = createWindow(&rect);
+    window->setVisible(false);
+    window->setFramerateLimit(0);
+    bool written = false;
+    {
+        FrameCapture capture(options.capture, options.size, options.fps);
+        if (capture.isOpen())
+        {
+            std::cout << "CAPTURE: " << options.frames << " frames, seed " << seed << "\n";
+            GameManager game(window, font);
+            game.setRenderScale(1.0f);
+            // The shaders compile in the background, frames before that would open the video unbloomed
+            while (!game.isPostProcessSettled())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            game.setFrameCapture(&capture);
+            for (int i = 0; i < options.frames; i++)
+            {
+                game.step(1.0f / options.fps);
+            }
+            game.setFrameCapture(nullptr);
+            written = capture.finish();
+        }
+    }
+    delete window;
+    World::setCurrent(nullptr);
+    return written ? 0 : 1;
+}
+
+int run(const Options& options) 
+{
+    if (!options.scenario.empty() || !options.record.empty() || !options.replay.empty())
+    {
+        std::shared_ptr<sf::Font> font = loadFont();
+        if (!font)
+        {
+            return 1;
+        }
+        if (!options.scenario.empty())
+        {
+            return runScenario(options, font);
+        }
+        return runRecorded(options, font);
+    }
+    return runWorlds(options);
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+    if (!options.baseline.empty())
+    {
+        return Scenario::compare(options.baseline, options.current, options.threshold) == 0 ? 0 : 1;
+    }
+    Config::load(options.config);
+    if (options.benchBodies > 0)
+    {
+        if (options.hasSeed)
+        {
+            Random::seed(options.seed);
+        }
+        return BarnesHut::benchmark(options.benchBodies, Config::get().threads);
+    }
+    if (options.verifyDeterminism)
+    {
+        return verifyDeterminism(options);
+    }
+    if (!options.render.empty())
+    {
+        return renderSoftware(options);
+    }
+    if (!options.capture.empty())
+    {
+#ifdef RSS_PROFILING
+        Profiler::setThreadName("Main");
+#endif
+        return captureFrames(options);
+    }
+    if (options.diffSolvers)
+    {
+        std::shared_ptr<sf::Font> font = loadFont();
+        if (!font)
+        {
+            return 1;
+        }
+        SolverDiff diff(font, options.hasSeed ? options.seed : Random::getSeed(), options.frames);
+        return diff.run() == 0 ? 0 : 1;
+    }
+    if (options.verifyQueries)
+    {
+        std::shared_ptr<sf::Font> font = loadFont();
+        if (!font)
+        {
+            return 1;
+        }
+        QueryCheck check(font, options.hasSeed ? options.seed : Random::getSeed(), options.frames);
+        return check.run() == 0 ? 0 : 1;
+    }
+#ifdef RSS_PROFILING
+    Profiler::setThreadName("Main");
+    Profiler::installSignalHandler();
+#endif
+#ifdef RSS_TRACK_ALLOCS
+    // Only a headless scenario steps the same frames every run, interactive runs just report
+    if (!options.scenario.empty() && options.headless)
+    {
+        AllocTracker::setFrameBudget(0, ALLOC_WARMUP_FRAMES);
+    }
+    AllocTracker::setCallSites(std::getenv("RSS_ALLOC_SITES") != nullptr);
+#endif
+    int result = run(options);
+#ifdef RSS_TRACK_ALLOCS
+    ALLOC_REPORT();
+    if (!AllocTracker::isWithinBudget())
+    {
+        result = 1;
+    }
+#endif
+    return result;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Generates src/EmbeddedAssets.inc from the font and shader files.
+
+Run from the repository root after changing anything under Fonts/ or Shaders/:
+
+    python tools/embed_assets.py
+
+The output is a plain byte array per file so it compiles on any compiler,
+string literals would hit MSVC's 64 KB limit with the font.
+"""
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = [
+    ("Fonts", (".ttf",)),
+    ("Shaders", (".frag", ".glsl", ".cfg")),
+]
+OUTPUT = os.path.join(ROOT, "src", "EmbeddedAssets.inc")
+VALUES_PER_LINE = 32
+
+
+def collect():
+    assets = []
+    for directory, extensions in SOURCES:
+        for name in sorted(os.listdir(os.path.join(ROOT, directory))):
+            if name.lower().endswith(extensions):
+                assets.append(directory + "/" + name)
+    return assets
+
+
+def main():
+    assets = collect()
+    lines = [
+        "// Generated by tools/embed_assets.py, do not edit.",
+        "// Included by Assets.cpp only.",
+        "",
+    ]
+    for index, name in enumerate(assets):
+        with open(os.path.join(ROOT, name), "rb") as f:
+            data = f.read()
+        lines.append("// %s, %d bytes" % (name, len(data)))
+        lines.append("static const unsigned char ASSET_%d[] =" % index)
+        lines.append("{")
+        for start in range(0, len(data), VALUES_PER_LINE):
+            chunk = data[start:start + VALUES_PER_LINE]
+            lines.append("\t" + ",".join(str(b) for b in chunk) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const EmbeddedAsset EMBEDDED_ASSETS[] =")
+    lines.append("{")
+    for index, name in enumerate(assets):
+        lines.append('\t{ "%s", ASSET_%d, sizeof(ASSET_%d) },' % (name, index, index))
+    lines.append("};")
+    with open(OUTPUT, "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+    print("embedded %d assets into %s" % (len(assets), os.path.relpath(OUTPUT, ROOT)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())